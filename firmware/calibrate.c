@@ -0,0 +1,158 @@
+/**
+@file calibrate.c
+@brief Background ambient light calibration
+@author Joe Brown
+*/
+#include "global.h"
+#include "calibrate.h"
+#include "detect.h"
+#include "schedule.h"
+#include "tcs3414_color_sensor.h"
+#include "flash.h"
+#include "fixed.h"
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Locals
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+#define CALIBRATE_SAMPLES   (1 << CALIBRATE_SAMPLES_SHIFT)
+
+#define CALIBRATE_MAGIC     0xCA1B
+#define CALIBRATE_SEGMENT   FLASH_INFO_D
+
+/** @brief Calibration record stored in information flash */
+typedef struct
+{
+    uint16_t magic;     /**< CALIBRATE_MAGIC when the segment was written by us */
+    uint8_t  sensor;    /**< Tcs3414Settings() the baselines were taken with */
+    uint8_t  reserved;
+    Baseline red;
+    Baseline green;
+    uint16_t crc;       /**< FlashCrc16 of everything above */
+} CalibrationRecord;
+
+static uint8_t  pending = FALSE;
+static uint8_t  save_ready = FALSE;
+static uint8_t  sample_count = 0;
+static uint32_t sample_time = 0;
+static uint32_t sample_period = 0;
+static uint32_t red_sum = 0;
+static uint32_t green_sum = 0;
+
+/**
+@brief Check a baseline has moved far enough from the saved one to rewrite it
+@param[in] saved baseline in flash
+@param[in] now baseline the detector is using
+@return TRUE if the means are further apart than the noise and the minimum step
+*/
+static uint8_t BaselineMoved(const Baseline* saved, const Baseline* now)
+{
+    uint32_t step = now->mean >> CALIBRATE_SAVE_SHIFT;
+    uint32_t diff = (now->mean > saved->mean) ? now->mean - saved->mean :
+                                                saved->mean - now->mean;
+    if (now->dev > step)
+    {
+        step = now->dev;
+    }
+    return (diff > step);
+}
+
+/**
+@brief Check a calibration record was written by us for this sensor setup
+@param[in] rec record to check
+@return TRUE if the magic, sensor settings and CRC all match
+*/
+static uint8_t RecordValid(const CalibrationRecord* rec)
+{
+    return (rec->magic == CALIBRATE_MAGIC &&
+            rec->sensor == Tcs3414Settings() &&
+            rec->crc == FlashCrc16(rec, sizeof(CalibrationRecord) - sizeof(uint16_t)));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                Calibration
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CalibrateStart(void)
+{
+    // CalibrateSample may still be summing an earlier run from the
+    // scheduler interrupt, keep it out until the sums are all cleared
+    // With the VLO converting a time is a call, do it here and not per sample
+    uint32_t period = SCHEDULE_TICKS(CALIBRATE_PERIOD_MS);
+    uint16_t gie = __get_SR_register() & GIE;
+    _DINT();
+    sample_period = period;
+    sample_count = 0;
+    red_sum = 0;
+    green_sum = 0;
+    pending = TRUE;
+    if (gie)
+    {
+        _EINT();
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CalibrateSample(const ColorReading* color, uint32_t now)
+{
+    // A laser on the sensor is not ambient light
+    if (!pending || DetectCandidate())
+    {
+        return;
+    }
+    if (sample_count && now - sample_time < sample_period)
+    {
+        return;
+    }
+    sample_time = now;
+    red_sum = FixedAccumulate(red_sum, color->red);
+    green_sum = FixedAccumulate(green_sum, color->green);
+    if (++sample_count == CALIBRATE_SAMPLES)
+    {
+        DetectReseed(FIXED_MEAN(red_sum, CALIBRATE_SAMPLES_SHIFT),
+                     FIXED_MEAN(green_sum, CALIBRATE_SAMPLES_SHIFT));
+        pending = FALSE;
+        save_ready = TRUE;
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                Persistence
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t CalibrateLoad(void)
+{
+    const CalibrationRecord* rec = (const CalibrationRecord*)CALIBRATE_SEGMENT;
+    if (!RecordValid(rec))
+    {
+        return (FAILURE);
+    }
+    DetectRestore(&rec->red, &rec->green);
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CalibrateSave(void)
+{
+    const CalibrationRecord* old = (const CalibrationRecord*)CALIBRATE_SEGMENT;
+    CalibrationRecord rec;
+    rec.magic = CALIBRATE_MAGIC;
+    rec.sensor = Tcs3414Settings();
+    rec.reserved = 0;
+    DetectSnapshot(&rec.red, &rec.green);
+    if (RecordValid(old) &&
+        !BaselineMoved(&old->red, &rec.red) &&
+        !BaselineMoved(&old->green, &rec.green))
+    {
+        return;
+    }
+    rec.crc = FlashCrc16(&rec, sizeof(CalibrationRecord) - sizeof(uint16_t));
+    FlashWriteSegment(CALIBRATE_SEGMENT, &rec, sizeof(CalibrationRecord));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CalibrateCommit(void)
+{
+    if (save_ready)
+    {
+        save_ready = FALSE;
+        CalibrateSave();
+    }
+}
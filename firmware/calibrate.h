@@ -0,0 +1,64 @@
+/**
+@file calibrate.h
+@brief Definitions for background ambient light calibration
+@author Joe Brown
+*/
+#ifndef CALIBRATE_H
+#define CALIBRATE_H
+
+#include "tcs3414_color_sensor.h"
+
+/**
+@brief Request a new ambient calibration
+@details
+Clear the sample sums and mark a calibration as pending, with interrupts
+disabled so a run already pending restarts cleanly. The samples come from
+CheckForHit, so nothing is taken until the target is detecting.
+*/
+extern void CalibrateStart(void);
+
+/**
+@brief Offer a detector sample to a pending calibration
+@details
+Called by CheckForHit after DetectSample with the sample it just used, so
+calibrating costs no sensor reads of its own. Samples less than
+CALIBRATE_PERIOD_MS after the last one taken, or while the detector is
+tracking a hit candidate, are skipped. Once 2^CALIBRATE_SAMPLES_SHIFT samples
+are in, the averages replace the detector baseline means with DetectReseed.
+Since this runs from the scheduler like CheckForHit the detector never sees
+half-updated thresholds.
+@param[in] color red and green as given to the detector
+@param[in] now time the sample was taken
+*/
+extern void CalibrateSample(const ColorReading* color, uint32_t now);
+
+/**
+@brief Load the last good calibration from information flash
+@details
+Check the record in information flash for the right magic number, a CRC that
+matches and the same sensor gain and integration time we run with now. If it
+is good the stored baselines go straight into the detector.
+@return SUCCESS if the detector was loaded from flash, FAILURE otherwise
+*/
+extern int8_t CalibrateLoad(void);
+
+/**
+@brief Write the detector's current baselines to information flash
+@details
+The means track every ambient sample, so to save flash wear the record is only
+rewritten when one has moved from what is stored by more than its noise
+estimate and 1/2^CALIBRATE_SAVE_SHIFT of itself, or the stored record is not
+valid. The CPU stalls while the segment is erased
+so do not call this from the scheduler.
+*/
+extern void CalibrateSave(void);
+
+/**
+@brief Save a finished background calibration
+@details
+CalibrateSample runs from the scheduler interrupt so it only flags that a new
+calibration is ready. Call this from the main loop to write it to flash.
+*/
+extern void CalibrateCommit(void);
+
+#endif // CALIBRATE_H
@@ -0,0 +1,147 @@
+/**
+@file capture.c
+@brief Samples around the most recent hit candidate for disputed hits
+@author Joe Brown
+*/
+#include "global.h"
+#include "capture.h"
+#include "flash.h"
+
+#ifdef DETECT_CAPTURE
+// Header, hit report and fused position, then the samples
+#if (CAPTURE_PRE < 1) || (CAPTURE_POST < 1) || \
+    (4 + 10 + 4 + 6 * (CAPTURE_PRE + CAPTURE_POST) > FLASH_INFO_SEGMENT_SIZE)
+#error "CAPTURE_PRE and CAPTURE_POST must be at least 1 and fit a flash segment"
+#endif
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Locals
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+enum CaptureState
+{
+    CAPTURE_EMPTY,      // nothing captured since the last dump
+    CAPTURE_OPEN,       // candidate open, holding its latest sample in post[0]
+    CAPTURE_CLOSED,     // filling post[1] on
+    CAPTURE_FROZEN      // full, waiting for CaptureDump or the next candidate
+};
+
+static CaptureSlot capture;
+static uint8_t state = CAPTURE_EMPTY;
+/** @brief next post slot once closed */
+static uint8_t next = 0;
+
+/** @brief The last CAPTURE_PRE samples, always running so a candidate can
+replace the one held at any time. Copied to capture.pre when one opens.*/
+static CaptureEntry ring[CAPTURE_PRE];
+/** @brief next ring slot, also its oldest sample */
+static uint8_t ring_next = 0;
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Capture
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CaptureRecord(const ColorReading* color, uint32_t now)
+{
+    CaptureEntry* entry = &ring[ring_next];
+    if (++ring_next == CAPTURE_PRE)
+    {
+        ring_next = 0;
+    }
+    entry->red   = color->red;
+    entry->green = color->green;
+    entry->time  = (uint16_t)now;
+
+    switch (state)
+    {
+        case CAPTURE_OPEN:
+        {
+            capture.post[0] = *entry;
+            break;
+        }
+        case CAPTURE_CLOSED:
+        {
+            capture.post[next] = *entry;
+            if (++next == CAPTURE_POST)
+            {
+                state = CAPTURE_FROZEN;
+            }
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CaptureRise(void)
+{
+    // Newest wins, but an accepted hit stays until it has been written
+    if (state == CAPTURE_OPEN ||
+        (state != CAPTURE_EMPTY && capture.result == CANDIDATE_ACCEPTED))
+    {
+        return;
+    }
+    // Zeros for post samples that never come, like after a stun
+    memset(&capture, 0, sizeof(capture));
+    // The sample that rose was the last one recorded, so the ring is already
+    // in the order the slot wants
+    memcpy(capture.pre, ring, sizeof(ring));
+    capture.oldest = ring_next;
+    state = CAPTURE_OPEN;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CaptureEnd(uint32_t length, enum CandidateResult result)
+{
+    if (state == CAPTURE_OPEN)
+    {
+        capture.result = result;
+        capture.length = (length > 0xFFFF) ? 0xFFFF : length;
+        next = 1;
+        state = (CAPTURE_POST > 1) ? CAPTURE_CLOSED : CAPTURE_FROZEN;
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CaptureCancel(void)
+{
+    if (state == CAPTURE_OPEN)
+    {
+        // What was held before it was overwritten when it opened
+        state = CAPTURE_EMPTY;
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CaptureReport(const DetectHit* hit, const FuseHit* where)
+{
+    if (state == CAPTURE_EMPTY || capture.result != CANDIDATE_ACCEPTED)
+    {
+        return;
+    }
+    capture.hit = *hit;
+#ifdef DETECT_FUSE
+    capture.where = *where;
+#endif
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint8_t CaptureFilling(void)
+{
+    return (state == CAPTURE_CLOSED);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CaptureDump(void)
+{
+    // Nothing new since the last dump, or it is already there
+    if ((state == CAPTURE_CLOSED || state == CAPTURE_FROZEN) &&
+        memcmp(FLASH_INFO_B, &capture, sizeof(capture)) != 0)
+    {
+        FlashWriteSegment(FLASH_INFO_B, &capture, sizeof(capture));
+        memset(&capture, 0, sizeof(capture));
+        state = CAPTURE_EMPTY;
+    }
+}
+#endif // DETECT_CAPTURE
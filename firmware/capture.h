@@ -0,0 +1,103 @@
+/**
+@file capture.h
+@brief Definitions for capturing the samples around a hit candidate
+@author Joe Brown
+*/
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "tcs3414_color_sensor.h"
+#include "stats.h"
+#include "detect.h"
+#include "fuse.h"
+
+/** @brief One CheckForHit sample */
+typedef struct
+{
+    uint16_t red;
+    uint16_t green;
+    uint16_t time;                      /**< low 16 bits of TimeNow() */
+} CaptureEntry;
+
+/** @brief A captured candidate, also the layout written to information flash.
+pre is a ring, oldest is the index of its oldest sample and the newest is the
+one that started the candidate. post[0] is the sample that ended it.*/
+typedef struct
+{
+    uint8_t      result;                /**< enum CandidateResult */
+    uint8_t      oldest;
+    uint16_t     length;                /**< rise to end in ticks, saturated */
+    DetectHit    hit;                   /**< STUN event details, zeros unless accepted */
+#ifdef DETECT_FUSE
+    FuseHit      where;                 /**< where it landed, zeros unless accepted */
+#endif
+    CaptureEntry pre[CAPTURE_PRE];
+    CaptureEntry post[CAPTURE_POST];
+} CaptureSlot;
+
+/**
+@brief Add a sample to the capture
+@details
+Called by CheckForHit with every sample, before it goes to the detector.
+Every sample goes into the pre-trigger ring. While a candidate is open it is
+also held as the possible end, and once the candidate has ended it fills the
+post-trigger samples. Once those are full the capture is frozen until the
+next candidate opens or CaptureDump.
+@param[in] color red and green from the sensor
+@param[in] now time the sample was taken
+*/
+extern void CaptureRecord(const ColorReading* color, uint32_t now);
+
+/**
+@brief Start capturing a candidate the detector opened
+@details
+The newest candidate replaces the one held, with a copy of the pre-trigger
+ring, unless the one held was accepted and has not been dumped yet. That way
+a rejected flicker never hides the hit that stuns the target.
+*/
+extern void CaptureRise(void);
+
+/**
+@brief Start filling the post-trigger samples, the detector closed a candidate
+@param[in] length time from the rise to the sample that ended it in ticks
+@param[in] result how the candidate was judged
+*/
+extern void CaptureEnd(uint32_t length, enum CandidateResult result);
+
+/**
+@brief Drop a candidate the detector threw away without judging it
+*/
+extern void CaptureCancel(void);
+
+/**
+@brief Log what the STUN event carried with the accepted candidate
+@details
+Called from the Stunned state before CaptureDump so the intensity,
+confidence, shooter and color of a hit, and where it landed, are kept with the
+samples it was judged on. Ignored unless the capture holds an accepted
+candidate.
+@param[in] hit the detector's details of the hit
+@param[in] where fused position, NULL without DETECT_FUSE
+*/
+extern void CaptureReport(const DetectHit* hit, const FuseHit* where);
+
+/**
+@brief Check the capture is still waiting for post-trigger samples
+@return TRUE from the end of a candidate until CAPTURE_POST samples are in
+*/
+extern uint8_t CaptureFilling(void);
+
+/**
+@brief Copy the capture to information flash and start a new one
+@details
+The target has no serial port so the capture is written to information
+segment B, where a debugger can read it back (e.g. mspdebug "md 0x1080 64").
+Nothing is written, and the segment is not erased, if no candidate was
+captured since the last dump or the segment already holds this one, so the
+last capture stays readable. On a stun this is the accepted hit, once the
+post-trigger samples have been read. The CPU stalls while the segment is
+erased so do not call this from the scheduler.
+*/
+extern void CaptureDump(void);
+
+#endif // CAPTURE_H
@@ -0,0 +1,108 @@
+/**
+@file decimate.c
+@brief Oversampling filter in front of the hit detector
+@author Joe Brown
+*/
+#include "global.h"
+#include "decimate.h"
+
+#ifdef DETECT_DECIMATE
+#if (DECIMATE_ORDER < 1) || (DECIMATE_ORDER * DECIMATE_SHIFT > 16)
+#error "DECIMATE_ORDER must be at least 1 and the filter gain fit 32 bits"
+#endif
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Locals
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+/** @brief Filter state for one channel. The integrators are allowed to wrap,
+the combs take differences so the output is still right as long as it fits
+in 32 bits.*/
+typedef struct
+{
+    uint32_t integ[DECIMATE_ORDER];
+    uint32_t comb[DECIMATE_ORDER];
+} Cic;
+
+static Cic red_cic;
+static Cic green_cic;
+#ifdef DETECT_READ_ALL_COLORS
+static Cic blue_cic;
+static Cic clear_cic;
+#endif
+
+/** @brief reads since the last output */
+static uint8_t reads = 0;
+/** @brief outputs still to drop after a reset */
+static uint8_t settle = DECIMATE_ORDER - 1;
+
+/**
+@brief Add a read to a channel and, on an output, run the combs
+@return the filtered sample in sensor counts when output is TRUE
+*/
+static uint16_t CicStep(Cic* cic, uint16_t x, uint8_t output);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Filter
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void DecimateReset(void)
+{
+    memset(&red_cic, 0, sizeof(red_cic));
+    memset(&green_cic, 0, sizeof(green_cic));
+#ifdef DETECT_READ_ALL_COLORS
+    memset(&blue_cic, 0, sizeof(blue_cic));
+    memset(&clear_cic, 0, sizeof(clear_cic));
+#endif
+    reads = 0;
+    settle = DECIMATE_ORDER - 1;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint8_t DecimateSample(ColorReading* color)
+{
+    uint8_t output = (++reads == _BV(DECIMATE_SHIFT));
+
+    color->red   = CicStep(&red_cic, color->red, output);
+    color->green = CicStep(&green_cic, color->green, output);
+#ifdef DETECT_READ_ALL_COLORS
+    color->blue  = CicStep(&blue_cic, color->blue, output);
+    color->clear = CicStep(&clear_cic, color->clear, output);
+#endif
+    if (!output)
+    {
+        return (FALSE);
+    }
+    reads = 0;
+    if (settle)
+    {
+        settle--;
+        return (FALSE);
+    }
+    return (TRUE);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint16_t CicStep(Cic* cic, uint16_t x, uint8_t output)
+{
+    uint32_t y = x;
+    uint32_t d = 0;
+    uint8_t i = 0;
+    for (i = 0;i < DECIMATE_ORDER;i++)
+    {
+        cic->integ[i] += y;
+        y = cic->integ[i];
+    }
+    if (!output)
+    {
+        return (0);
+    }
+    for (i = 0;i < DECIMATE_ORDER;i++)
+    {
+        d = y - cic->comb[i];
+        cic->comb[i] = y;
+        y = d;
+    }
+    // The gain is 2^(ORDER * SHIFT) and the weights are all positive, so the
+    // scaled output is never more than the largest read
+    return (y >> (DECIMATE_ORDER * DECIMATE_SHIFT));
+}
+#endif // DETECT_DECIMATE
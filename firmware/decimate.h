@@ -0,0 +1,34 @@
+/**
+@file decimate.h
+@brief Definitions for the oversampling filter in front of the hit detector
+@author Joe Brown
+*/
+#ifndef DECIMATE_H
+#define DECIMATE_H
+
+#include "tcs3414_color_sensor.h"
+
+/**
+@brief Forget everything read so far
+@details
+Call before the first read after the sensor has been shut down or detection
+was paused, so stale reads are not mixed into the next detector sample.
+*/
+extern void DecimateReset(void);
+
+/**
+@brief Filter one sensor read
+@details
+Runs the read through a CIC filter of DECIMATE_ORDER integrator and comb
+stages per channel. Every 2^DECIMATE_SHIFT reads the combs run and the reading
+is replaced with the filter output, scaled back to sensor counts. After a
+reset the first DECIMATE_ORDER - 1 outputs are still filling the filter and
+are dropped. Only red and green are filtered unless DETECT_READ_ALL_COLORS is
+defined. Costs DECIMATE_ORDER 32 bit adds per channel per read and the same
+again on an output.
+@param[in,out] color the read, replaced with the filtered sample on output
+@return TRUE if color now holds a sample for the detector, FALSE otherwise
+*/
+extern uint8_t DecimateSample(ColorReading* color);
+
+#endif // DECIMATE_H
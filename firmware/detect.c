@@ -0,0 +1,847 @@
+/**
+@file detect.c
+@brief Laser hit detection
+@author Joe Brown
+*/
+#include "global.h"
+#include "detect.h"
+#include "schedule.h"
+#include "stats.h"
+#include "capture.h"
+#include "fixed.h"
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Locals
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+/** @brief n/16 of x using only shifts, n must be a constant from 0 to 16 */
+#define FRAC16(x,n)     FIXED_FRAC16(x,n)
+
+static Baseline red_base;
+static Baseline green_base;
+
+static uint16_t red_thresh = 0;
+static uint16_t green_thresh = 0;
+
+/** @brief valid hit window converted to scheduler ticks */
+static uint32_t hit_min_time = 0;
+static uint32_t hit_max_time = 0;
+
+/** @brief set while the laser may be on target */
+static uint8_t  candidate = FALSE;
+/** @brief time the current candidate first crossed the threshold */
+static uint32_t rise_time = 0;
+#ifdef DETECT_STATS
+/** @brief time of the most recent sample above threshold */
+static uint32_t last_time = 0;
+#endif
+#if DETECT_DROPOUT_SAMPLES
+/** @brief samples in a row the current candidate has gone without the laser */
+static uint8_t  dropout = 0;
+/** @brief time of the first of them */
+static uint32_t fall_time = 0;
+#endif
+
+#if defined(DETECT_FLASH_REJECT) && \
+    (DETECT_MODE != DETECT_MODE_THRESHOLD && DETECT_MODE != DETECT_MODE_CHROMA)
+#error "DETECT_FLASH_REJECT needs the THRESHOLD or CHROMA comparator"
+#endif
+#if defined(DETECT_FLASH_REJECT) && defined(DETECT_PULSE_CODE)
+#error "DETECT_FLASH_REJECT would see a chopped laser as drooping"
+#endif
+
+#if DETECT_MODE == DETECT_MODE_GOERTZEL && defined(GOERTZEL_BLOCK_TOO_LONG)
+#error "A Goertzel block lasts more than half of DETECT_HIT_MIN_MS, sample faster"
+#endif
+
+#if defined(DETECT_LEARN) && \
+    (DETECT_MODE != DETECT_MODE_THRESHOLD || defined(DETECT_PULSE_CODE))
+#error "DETECT_LEARN needs the THRESHOLD comparator and a steady laser"
+#endif
+
+#ifdef DETECT_LEARN
+/** @brief Red excess over baseline while the laser is on, learned from
+accepted hits. The ambient baseline is the other cluster.*/
+static Baseline hit_cluster;
+/** @brief hit_cluster with the current candidate learned, kept if accepted */
+static Baseline hit_pending;
+/** @brief accepted hits learned, saturates at LEARN_MIN_HITS */
+static uint8_t  hits_learned = 0;
+/** @brief red excess between the clusters, from ClusterBoundary */
+static uint16_t hit_boundary = 0;
+#endif
+
+#if DETECT_MODE == DETECT_MODE_CLASSIFY
+#define TRACK_CLEAR
+static Baseline clear_base;
+static uint16_t clear_thresh = 0;
+#endif
+
+#ifdef DETECT_FLASH_REJECT
+/** @brief Blue and clear ambient with DETECT_BASELINE_FRAC fractional bits.
+Unlike the baselines these follow the light quickly both ways, so a target
+turning in uneven light does not read as blue or white excess.*/
+static uint32_t flash_blue = 0;
+static uint32_t flash_clear = 0;
+/** @brief set once any sample in the candidate looked like a flash */
+static uint8_t  flash_reject = FALSE;
+/** @brief candidate samples in a row under 1/2^FLASH_DROOP_SHIFT of the peak */
+static uint8_t  flash_droop = 0;
+#else
+#define flash_reject FALSE
+#endif
+
+#if DETECT_MODE == DETECT_MODE_CLASSIFY
+/** @brief Share of the clear channel each laser color puts on red, green and
+blue, in 16ths. A sample matches a class when every channel is inside its
+min/max. Classes are tried in order and the first match wins.*/
+typedef struct
+{
+    uint8_t color;      /**< enum LaserColor */
+    uint8_t red_min;
+    uint8_t red_max;
+    uint8_t green_min;
+    uint8_t green_max;
+    uint8_t blue_min;
+    uint8_t blue_max;
+} LaserSignature;
+
+static const LaserSignature laser_signatures[] =
+{
+//   Color          Red     Green   Blue
+    {LASER_RED,     9, 16,  0, 4,   0, 4},
+    {LASER_GREEN,   0, 4,   9, 16,  0, 6},
+    {LASER_BLUE,    0, 4,   0, 6,   9, 16}
+};
+#define NUM_LASER_SIGNATURES (sizeof(laser_signatures) / sizeof(laser_signatures[0]))
+
+/** @brief class of the last sample the comparator matched */
+static uint8_t  sample_color = LASER_UNKNOWN;
+/** @brief class and clear level of the brightest sample in the candidate */
+static uint8_t  candidate_color = LASER_UNKNOWN;
+static uint16_t candidate_peak = 0;
+#endif
+
+#if DETECT_MODE == DETECT_MODE_GOERTZEL
+#define GOERTZEL_BLOCK      (1 << GOERTZEL_BLOCK_SHIFT)
+
+/** @brief Goertzel filter state, see GoertzelUpdate */
+static int32_t  goertzel_s1 = 0;
+static int32_t  goertzel_s2 = 0;
+static uint32_t goertzel_dc = 0;
+static uint8_t  goertzel_n = 0;
+/** @brief decision from the last complete block */
+static uint8_t  goertzel_hit = FALSE;
+#endif
+
+/** @brief details of the last accepted hit */
+static DetectHit last_hit;
+
+// Hit intensity is measured on the channel the comparator cares about most
+#if DETECT_MODE == DETECT_MODE_CLASSIFY
+#define INTENSITY_BASE      clear_base
+#define INTENSITY_THRESH    clear_thresh
+#define INTENSITY(c)        ((c)->clear)
+#else
+#define INTENSITY_BASE      red_base
+#define INTENSITY_THRESH    red_thresh
+#define INTENSITY(c)        ((c)->red)
+#endif
+
+/** @brief running peak and sum of the excess over baseline in the candidate */
+static uint16_t excess_peak = 0;
+static uint32_t excess_sum = 0;
+
+#ifdef DETECT_PULSE_CODE
+/** @brief On/off pattern each shooter's laser repeats, one bit per sample with
+the oldest sample in the high bit. The shooter ID is the index plus one. We can
+lock on at any phase so no code may be a rotation of another.*/
+static const uint8_t pulse_codes[] =
+{
+    0xF0,   // 11110000
+    0xE8,   // 11101000
+    0xE4,   // 11100100
+    0xD4    // 11010100
+};
+#define NUM_PULSE_CODES     (sizeof(pulse_codes) / sizeof(pulse_codes[0]))
+#define PULSE_GAP_MASK      ((1 << PULSE_GAP_SAMPLES) - 1)
+
+/** @brief comparator output for the last 8 samples, newest in bit 0 */
+static uint8_t  pulse_history = 0;
+/** @brief shooter matched during the current candidate, 0 if none yet */
+static uint8_t  pulse_shooter = 0;
+#endif
+
+/**
+@brief Move a baseline toward a new sample
+@details
+A baseline that was never seeded (mean of zero) jumps straight to the sample.
+The mean moves up by 1/2^DETECT_BASELINE_RISE_SHIFT of the difference when the
+sample is above it and down by 1/2^DETECT_BASELINE_FALL_SHIFT when it is below.
+The deviation is averaged the same way with DETECT_NOISE_SHIFT. Everything is
+unsigned shifts and adds so there is no multiply or divide on the MSP430.
+@param[in] b baseline to update
+@param[in] sample new raw channel reading
+*/
+static void BaselineUpdate(Baseline* b, uint16_t sample);
+
+/**
+@brief Recompute the red and green thresholds from the current baselines
+*/
+static void ThresholdUpdate(void);
+
+#ifdef DETECT_LEARN
+/**
+@brief Move a cluster toward a new sample
+@details
+Like BaselineUpdate but the mean moves 1/2^LEARN_SHIFT of the way both up
+and down, and the deviation the same.
+@param[in] c cluster to update
+@param[in] sample excess over baseline
+*/
+static void ClusterUpdate(Baseline* c, uint16_t sample);
+
+/**
+@brief Red excess at which a sample is as far from the ambient as from the hits
+@details
+With both spreads measured as mean deviation the boundary between ambient
+(deviation db) and hits (mean mh, deviation dh) is mh * db / (db + dh) above
+the baseline. It is kept to no more than halfway to mh so a run of bright
+hits cannot push it up until dimmer ones are lost. The ratio is found with one
+FixedDiv to 1/256ths and applied with one FixedMul, so this runs once per
+accepted hit with the ambient noise of the moment, never per sample.
+@param[in] noise ambient deviation in counts
+@return boundary in counts above the baseline
+*/
+static uint32_t ClusterBoundary(uint32_t noise);
+#endif
+
+/**
+@brief Decide whether a single sample looks like the laser
+@details
+The comparator is selected at compile time with DETECT_MODE. The threshold
+comparator looks for red above its threshold with green below its own. The
+chromaticity comparator checks the share of clear taken by red, green and blue
+by comparing each channel against a shifted copy of clear, so there is no
+divide. The classifier does the same against each entry in laser_signatures
+and remembers which one matched. The Goertzel comparator looks for the red
+channel chopped at a quarter of the sample rate.
+@param[in] color sensor reading
+@return TRUE if the sample is a hit candidate, FALSE otherwise
+*/
+static uint8_t Comparator(const ColorReading* color);
+
+#if DETECT_MODE == DETECT_MODE_GOERTZEL
+/**
+@brief Run one red sample through the Goertzel filter
+@details
+With the chop at a quarter of the sample rate the Goertzel coefficient
+2cos(2pi/4) is zero and the recurrence is s = x - s2, two adds per sample. At
+the end of a block the result is s1 + j*s2 and steady light has cancelled out
+exactly. The magnitude is approximated as max + min/2 of the two parts, so no
+squares or roots. The decision is held until the next block completes.
+@param[in] red raw red reading
+@return TRUE if the last complete block had the chop frequency, FALSE otherwise
+*/
+static uint8_t GoertzelUpdate(uint16_t red);
+#endif
+
+/**
+@brief Drop the hit candidate in progress and everything measured about it
+*/
+static void CandidateClear(void);
+
+/**
+@brief Scale the peak excess of a hit against the threshold margin
+@details
+Computes 64 * excess / margin saturated to 255 by shift and subtract, one step
+per result bit, so it stays clear of the library divide.
+@param[in] excess peak excess over baseline
+@param[in] margin threshold minus baseline
+@return confidence where 64 is a hit just at threshold
+*/
+static uint8_t Confidence(uint32_t excess, uint32_t margin);
+
+#ifdef DETECT_FLASH_REJECT
+/**
+@brief Check a candidate sample against the shape of a laser
+@details
+A laser holds a flat plateau and only red rises. The sensor integrates over
+longer than a sample period, so the sample an edge lands in, and the one after
+it, read only part of the laser, but no more than one of those is under half
+the plateau. Flashes and strobes are brighter, decay over several samples and
+bring blue and clear up with red. See the DETECT_FLASH_REJECT settings for the
+exact rules. Call before the sample is added to the running peak.
+@param[in] color sensor reading
+@param[in] excess red over baseline for this sample
+@param[in] hit comparator output for this sample
+@return TRUE if the sample looks like a flash, FALSE otherwise
+*/
+static uint8_t FlashCheck(const ColorReading* color, uint16_t excess, uint8_t hit);
+
+/**
+@brief Move a flash ambient level 1/2^FLASH_AMBIENT_SHIFT of the way to a sample
+@param[in,out] level ambient level, seeded from the sample when zero
+@param[in] sample channel reading
+*/
+static void AmbientFollow(uint32_t* level, uint16_t sample);
+#endif
+
+#ifdef DETECT_PULSE_CODE
+/**
+@brief Decode a shooter code from the comparator output
+@details
+Shift the comparator output into the sample history and compare the history
+against every entry in pulse_codes. This is one compare per code so the cost
+per sample is fixed. A match is latched as the shooter for the candidate.
+@param[in] hit comparator output for this sample
+@return TRUE while the laser is present, i.e. any of the last PULSE_GAP_SAMPLES
+samples were on
+*/
+static uint8_t PulseDecode(uint8_t hit);
+#endif
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                Baseline
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void BaselineUpdate(Baseline* b, uint16_t sample)
+{
+    uint32_t x = (uint32_t)sample << DETECT_BASELINE_FRAC;
+    uint32_t diff = 0;
+    if (b->mean == 0)
+    {
+        b->mean = x;
+    }
+    if (x > b->mean)
+    {
+        diff = x - b->mean;
+        b->mean += diff >> DETECT_BASELINE_RISE_SHIFT;
+    }
+    else
+    {
+        diff = b->mean - x;
+        b->mean -= diff >> DETECT_BASELINE_FALL_SHIFT;
+    }
+
+    if (diff > b->dev)
+    {
+        b->dev += (diff - b->dev) >> DETECT_NOISE_SHIFT;
+    }
+    else
+    {
+        b->dev -= (b->dev - diff) >> DETECT_NOISE_SHIFT;
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void ThresholdUpdate(void)
+{
+    uint32_t base  = red_base.mean >> DETECT_BASELINE_FRAC;
+    uint32_t noise = red_base.dev  >> DETECT_BASELINE_FRAC;
+    uint32_t t = base + FRAC16(base, DETECT_RED_MARGIN) + (noise << DETECT_RED_NOISE_GAIN);
+#ifdef DETECT_LEARN
+    // Once enough hits are known split the clusters instead, but never go
+    // down into the ambient noise or flicker
+    if (hits_learned >= LEARN_MIN_HITS)
+    {
+        uint32_t floor = FRAC16(base, LEARN_FLOOR_MARGIN) + (noise << DETECT_RED_NOISE_GAIN);
+        t = base + ((hit_boundary > floor) ? hit_boundary : floor);
+    }
+#endif
+    red_thresh = FIXED_SAT16(t);
+
+    base  = green_base.mean >> DETECT_BASELINE_FRAC;
+    noise = green_base.dev  >> DETECT_BASELINE_FRAC;
+    t = base + FRAC16(base, DETECT_GREEN_MARGIN) + (noise << DETECT_GREEN_NOISE_GAIN);
+    green_thresh = FIXED_SAT16(t);
+
+#ifdef TRACK_CLEAR
+    base  = clear_base.mean >> DETECT_BASELINE_FRAC;
+    noise = clear_base.dev  >> DETECT_BASELINE_FRAC;
+    t = base + FRAC16(base, DETECT_CLEAR_MARGIN) + (noise << DETECT_CLEAR_NOISE_GAIN);
+    clear_thresh = FIXED_SAT16(t);
+#endif
+}
+
+#ifdef DETECT_LEARN
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void ClusterUpdate(Baseline* c, uint16_t sample)
+{
+    uint32_t x = (uint32_t)sample << DETECT_BASELINE_FRAC;
+    uint32_t diff = 0;
+    if (c->mean == 0)
+    {
+        c->mean = x;
+    }
+    if (x > c->mean)
+    {
+        diff = x - c->mean;
+        c->mean += diff >> LEARN_SHIFT;
+    }
+    else
+    {
+        diff = c->mean - x;
+        c->mean -= diff >> LEARN_SHIFT;
+    }
+
+    if (diff > c->dev)
+    {
+        c->dev += (diff - c->dev) >> LEARN_SHIFT;
+    }
+    else
+    {
+        c->dev -= (c->dev - diff) >> LEARN_SHIFT;
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint32_t ClusterBoundary(uint32_t noise)
+{
+    uint32_t mean = hit_cluster.mean >> DETECT_BASELINE_FRAC;
+    uint32_t spread = noise + (hit_cluster.dev >> DETECT_BASELINE_FRAC);
+    uint32_t frac = 128;
+    if (spread)
+    {
+        frac = FixedDiv(noise << 8, spread);
+        if (frac > 128)
+        {
+            frac = 128;
+        }
+    }
+    return (FixedMul(mean, frac) >> 8);
+}
+#endif
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                               Comparator
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+#if DETECT_MODE == DETECT_MODE_CHROMA
+uint8_t Comparator(const ColorReading* color)
+{
+    uint16_t clear = color->clear;
+    if (clear < DETECT_CHROMA_CLEAR_MIN)
+    {
+        return FALSE;
+    }
+    // Still require some red over ambient so sensor noise on a dim scene
+    // cannot wander across the chroma bounds
+    if (color->red <= (red_base.mean >> DETECT_BASELINE_FRAC) +
+                      ((red_base.dev >> DETECT_BASELINE_FRAC) << DETECT_RED_NOISE_GAIN))
+    {
+        return FALSE;
+    }
+    return (color->red   >= FRAC16(clear, DETECT_CHROMA_RED_MIN))   &&
+           (color->green <= FRAC16(clear, DETECT_CHROMA_GREEN_MAX)) &&
+           (color->blue  <= FRAC16(clear, DETECT_CHROMA_BLUE_MAX));
+}
+#elif DETECT_MODE == DETECT_MODE_CLASSIFY
+uint8_t Comparator(const ColorReading* color)
+{
+    uint16_t clear = color->clear;
+    const LaserSignature* sig = laser_signatures;
+    uint8_t i = 0;
+    if (clear <= clear_thresh || clear < DETECT_CHROMA_CLEAR_MIN)
+    {
+        return FALSE;
+    }
+    for (i = 0;i < NUM_LASER_SIGNATURES;i++,sig++)
+    {
+        if (color->red   >= FRAC16(clear, sig->red_min)   &&
+            color->red   <= FRAC16(clear, sig->red_max)   &&
+            color->green >= FRAC16(clear, sig->green_min) &&
+            color->green <= FRAC16(clear, sig->green_max) &&
+            color->blue  >= FRAC16(clear, sig->blue_min)  &&
+            color->blue  <= FRAC16(clear, sig->blue_max))
+        {
+            sample_color = sig->color;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+#elif DETECT_MODE == DETECT_MODE_GOERTZEL
+uint8_t Comparator(const ColorReading* color)
+{
+    return GoertzelUpdate(color->red);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint8_t GoertzelUpdate(uint16_t red)
+{
+    int32_t s0 = (int32_t)red - goertzel_s2;
+    uint32_t re = 0;
+    uint32_t im = 0;
+    uint32_t mag = 0;
+    goertzel_s2 = goertzel_s1;
+    goertzel_s1 = s0;
+    goertzel_dc += red;
+
+    if (++goertzel_n == GOERTZEL_BLOCK)
+    {
+        re = (goertzel_s1 < 0) ? -goertzel_s1 : goertzel_s1;
+        im = (goertzel_s2 < 0) ? -goertzel_s2 : goertzel_s2;
+        mag = (re > im) ? re + (im >> 1) : im + (re >> 1);
+        goertzel_hit = (mag >= (goertzel_dc >> GOERTZEL_DC_SHIFT)) &&
+                       (mag >= ((uint32_t)GOERTZEL_MIN_LEVEL << GOERTZEL_BLOCK_SHIFT));
+        goertzel_s1 = 0;
+        goertzel_s2 = 0;
+        goertzel_dc = 0;
+        goertzel_n = 0;
+    }
+    return goertzel_hit;
+}
+#else
+uint8_t Comparator(const ColorReading* color)
+{
+    return (color->red > red_thresh) && (color->green < green_thresh);
+}
+#endif
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                Intensity
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint8_t Confidence(uint32_t excess, uint32_t margin)
+{
+    if (margin == 0)
+    {
+        margin = 1;
+    }
+    return FIXED_SAT8(FixedDiv(excess << 6, margin));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                             Flash rejection
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+#ifdef DETECT_FLASH_REJECT
+uint8_t FlashCheck(const ColorReading* color, uint16_t excess, uint8_t hit)
+{
+    uint32_t base = 0;
+    uint16_t blue = 0;
+    uint16_t clear = 0;
+    if (!hit)
+    {
+        // Falling edge. Only a light still fading after a drooped sample
+        // is a flash, a laser leaves at most one partial sample.
+        return flash_droop && excess > (excess_peak >> FLASH_TAIL_SHIFT);
+    }
+    if (excess > FLASH_MAX_EXCESS)
+    {
+        return TRUE;
+    }
+    // With FLASH_DROOP_SAMPLES 0 nothing droops so the tail rule is off too
+    if (FLASH_DROOP_SAMPLES && excess < (excess_peak >> FLASH_DROOP_SHIFT))
+    {
+        if (++flash_droop >= FLASH_DROOP_SAMPLES)
+        {
+            return TRUE;
+        }
+    }
+    else
+    {
+        flash_droop = 0;
+    }
+    base  = flash_blue >> DETECT_BASELINE_FRAC;
+    blue  = (color->blue > base) ? color->blue - base : 0;
+    base  = flash_clear >> DETECT_BASELINE_FRAC;
+    clear = (color->clear > base) ? color->clear - base : 0;
+    return (blue > (excess >> FLASH_BLUE_SHIFT)) ||
+           ((uint32_t)clear > ((uint32_t)excess << FLASH_CLEAR_SHIFT));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void AmbientFollow(uint32_t* level, uint16_t sample)
+{
+    uint32_t x = (uint32_t)sample << DETECT_BASELINE_FRAC;
+    if (*level == 0)
+    {
+        *level = x;
+    }
+    else if (x > *level)
+    {
+        *level += (x - *level) >> FLASH_AMBIENT_SHIFT;
+    }
+    else
+    {
+        *level -= (*level - x) >> FLASH_AMBIENT_SHIFT;
+    }
+}
+#endif
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                               Pulse codes
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+#ifdef DETECT_PULSE_CODE
+uint8_t PulseDecode(uint8_t hit)
+{
+    uint8_t i = 0;
+    pulse_history = (pulse_history << 1) | (hit ? 1 : 0);
+    for (i = 0;i < NUM_PULSE_CODES;i++)
+    {
+        if (pulse_history == pulse_codes[i])
+        {
+            pulse_shooter = i + 1;
+        }
+    }
+    return (pulse_history & PULSE_GAP_MASK) != 0;
+}
+#endif
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                Detection
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void DetectInit(uint16_t red, uint16_t green)
+{
+    Baseline r = {(uint32_t)red << DETECT_BASELINE_FRAC, 0};
+    Baseline g = {(uint32_t)green << DETECT_BASELINE_FRAC, 0};
+    DetectRestore(&r, &g);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void DetectReseed(uint16_t red, uint16_t green)
+{
+    red_base.mean   = (uint32_t)red << DETECT_BASELINE_FRAC;
+    green_base.mean = (uint32_t)green << DETECT_BASELINE_FRAC;
+    ThresholdUpdate();
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void DetectRestore(const Baseline* red, const Baseline* green)
+{
+    red_base   = *red;
+    green_base = *green;
+    ThresholdUpdate();
+    hit_min_time = SCHEDULE_TICKS(DETECT_HIT_MIN_MS);
+    hit_max_time = SCHEDULE_TICKS(DETECT_HIT_MAX_MS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void DetectSnapshot(Baseline* red, Baseline* green)
+{
+    // CheckForHit updates the baselines from the scheduler interrupt, do not
+    // let it land between the halves of a 32 bit field
+    uint16_t gie = __get_SR_register() & GIE;
+    _DINT();
+    *red   = red_base;
+    *green = green_base;
+    if (gie)
+    {
+        _EINT();
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void DetectReset(void)
+{
+    CandidateClear();
+#ifdef DETECT_CAPTURE
+    CaptureCancel();
+#endif
+#ifdef TRACK_CLEAR
+    memset(&clear_base, 0, sizeof(clear_base));
+#endif
+#ifdef DETECT_FLASH_REJECT
+    flash_blue = 0;
+    flash_clear = 0;
+#endif
+#ifdef DETECT_PULSE_CODE
+    pulse_history = 0;
+#endif
+#if DETECT_MODE == DETECT_MODE_GOERTZEL
+    goertzel_s1 = 0;
+    goertzel_s2 = 0;
+    goertzel_dc = 0;
+    goertzel_n = 0;
+    goertzel_hit = FALSE;
+#endif
+#ifdef DETECT_LEARN
+    memset(&hit_cluster, 0, sizeof(hit_cluster));
+    hits_learned = 0;
+    hit_boundary = 0;
+#endif
+    memset(&last_hit, 0, sizeof(last_hit));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint8_t DetectCandidate(void)
+{
+    return candidate;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+const DetectHit* DetectLastHit(void)
+{
+    return &last_hit;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint8_t DetectSample(const ColorReading* color, uint32_t now)
+{
+    uint8_t ret = FALSE;
+    uint8_t hit = Comparator(color);
+    uint32_t on_time = 0;
+    uint32_t base = 0;
+    uint16_t excess = 0;
+
+#ifdef DETECT_PULSE_CODE
+    hit = PulseDecode(hit);
+#endif
+
+#if DETECT_DROPOUT_SAMPLES
+    // Ride out a short gap in a candidate without learning from it. If the
+    // laser does not come back the candidate ends where the gap began.
+    if (candidate && !hit)
+    {
+        if (dropout == 0)
+        {
+            fall_time = now;
+        }
+        if (dropout++ < DETECT_DROPOUT_SAMPLES)
+        {
+            return FALSE;
+        }
+        now = fall_time;
+    }
+    else
+    {
+        dropout = 0;
+    }
+#endif
+
+    // The baseline is frozen during a candidate so the excess is laser
+    base = INTENSITY_BASE.mean >> DETECT_BASELINE_FRAC;
+    excess = (INTENSITY(color) > base) ? INTENSITY(color) - base : 0;
+
+#ifdef DETECT_FLASH_REJECT
+    if (candidate || hit)
+    {
+        flash_reject |= FlashCheck(color, excess, hit);
+    }
+#endif
+
+    if (candidate)
+    {
+        on_time = now - rise_time;
+        if (!hit && on_time >= hit_min_time && on_time < hit_max_time && !flash_reject)
+        {
+            ret = TRUE;
+#ifdef DETECT_PULSE_CODE
+            last_hit.shooter = pulse_shooter;
+#endif
+#if DETECT_MODE == DETECT_MODE_CLASSIFY
+            last_hit.color = candidate_color;
+#else
+            last_hit.color = LASER_RED;
+#endif
+            last_hit.peak = excess_peak;
+            last_hit.energy = excess_sum;
+            base = INTENSITY_BASE.mean >> DETECT_BASELINE_FRAC;
+            last_hit.confidence = Confidence(excess_peak,
+                                             (INTENSITY_THRESH > base) ? INTENSITY_THRESH - base : 1);
+#ifdef DETECT_LEARN
+            // Only a candidate that passed every test is sure to be laser
+            hit_cluster = hit_pending;
+            hit_boundary = FIXED_SAT16(ClusterBoundary(red_base.dev >> DETECT_BASELINE_FRAC));
+            if (hits_learned < LEARN_MIN_HITS)
+            {
+                hits_learned++;
+            }
+#endif
+        }
+#if defined(DETECT_STATS) || defined(DETECT_CAPTURE)
+        if (!hit)
+        {
+            enum CandidateResult result = ret ? CANDIDATE_ACCEPTED :
+                                          flash_reject ? CANDIDATE_FLASH :
+                                          (on_time < hit_min_time) ? CANDIDATE_SHORT :
+                                          CANDIDATE_LONG;
+#ifdef DETECT_STATS
+            StatsCandidate(rise_time, last_time, now, result);
+#endif
+#ifdef DETECT_CAPTURE
+            CaptureEnd(on_time, result);
+#endif
+        }
+#endif
+    }
+    else if (hit)
+    {
+        candidate = TRUE;
+        rise_time = now;
+#ifdef DETECT_CAPTURE
+        CaptureRise();
+#endif
+#ifdef DETECT_LEARN
+        hit_pending = hit_cluster;
+#endif
+    }
+#ifdef DETECT_STATS
+    if (hit)
+    {
+        last_time = now;
+    }
+#endif
+    if (hit)
+    {
+        excess_sum = FixedAccumulate(excess_sum, excess);
+        if (excess > excess_peak)
+        {
+            excess_peak = excess;
+        }
+#ifdef DETECT_LEARN
+        ClusterUpdate(&hit_pending, excess);
+#endif
+    }
+#if DETECT_MODE == DETECT_MODE_CLASSIFY
+    if (hit && color->clear > candidate_peak)
+    {
+        candidate_peak = color->clear;
+        candidate_color = sample_color;
+    }
+#endif
+
+    // Only learn from samples that are not part of a hit candidate, otherwise
+    // the laser itself drags the baseline up. Anything on longer than a hit
+    // can last is a lighting change and must be learned or we lock up.
+    if (!candidate || on_time >= hit_max_time)
+    {
+        BaselineUpdate(&red_base, color->red);
+        BaselineUpdate(&green_base, color->green);
+        // Saved calibrations only carry red and green, the others seed
+        // themselves from the first sample
+#ifdef TRACK_CLEAR
+        BaselineUpdate(&clear_base, color->clear);
+#endif
+#ifdef DETECT_FLASH_REJECT
+        AmbientFollow(&flash_blue, color->blue);
+        AmbientFollow(&flash_clear, color->clear);
+#endif
+        ThresholdUpdate();
+    }
+
+    if (!hit)
+    {
+        CandidateClear();
+    }
+    return ret;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CandidateClear(void)
+{
+    candidate = FALSE;
+#if DETECT_DROPOUT_SAMPLES
+    dropout = 0;
+#endif
+    excess_peak = 0;
+    excess_sum = 0;
+#ifdef DETECT_FLASH_REJECT
+    flash_reject = FALSE;
+    flash_droop = 0;
+#endif
+#ifdef DETECT_PULSE_CODE
+    pulse_shooter = 0;
+#endif
+#if DETECT_MODE == DETECT_MODE_CLASSIFY
+    candidate_peak = 0;
+    candidate_color = LASER_UNKNOWN;
+#endif
+}
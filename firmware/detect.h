@@ -0,0 +1,127 @@
+/**
+@file detect.h
+@brief Definitions and prototypes for laser hit detection
+@author Joe Brown
+*/
+#ifndef DETECT_H
+#define DETECT_H
+
+#include "tcs3414_color_sensor.h"
+
+// Set when the detector needs blue and clear as well as red and green
+#if DETECT_MODE == DETECT_MODE_CHROMA || DETECT_MODE == DETECT_MODE_CLASSIFY || \
+    defined(DETECT_FLASH_REJECT)
+#define DETECT_READ_ALL_COLORS
+#endif
+
+/** @brief Streaming estimate of one sensor channel's ambient level. Both
+fields are fixed point with DETECT_BASELINE_FRAC fractional bits so the
+exponential averages can be done with nothing but shifts and adds.*/
+typedef struct
+{
+    uint32_t mean;  /**< exponential moving average of the channel */
+    uint32_t dev;   /**< exponential moving average of |sample - mean| */
+} Baseline;
+
+/** @brief Laser colors the detector can tell apart */
+enum LaserColor
+{
+    LASER_UNKNOWN,
+    LASER_RED,
+    LASER_GREEN,
+    LASER_BLUE
+};
+
+/** @brief Details of an accepted hit, read with DetectLastHit after
+DetectSample returns TRUE. CheckForHit latches them as it publishes the STUN
+event for the Stunned state, which logs them with DETECT_CAPTURE. Intensities
+are counts on red, or on clear when classifying.*/
+typedef struct
+{
+    uint32_t energy;    /**< sum of excess over baseline across the hit */
+    uint16_t peak;      /**< largest excess over baseline in one sample */
+    uint8_t confidence; /**< peak over threshold margin, 64 = at threshold */
+    uint8_t shooter;    /**< pulse code shooter ID, 0 if not decoded */
+    uint8_t color;      /**< enum LaserColor of the laser that hit */
+} DetectHit;
+
+/**
+@brief Seed the detector with a known ambient level
+@details
+Reset both channel baselines to the averages measured during calibration,
+clear the noise estimates and derive the initial thresholds from them. The hit
+window is converted to scheduler ticks here so the scheduler must already be
+initialized.
+@param[in] red average ambient red reading
+@param[in] green average ambient green reading
+*/
+extern void DetectInit(uint16_t red, uint16_t green);
+
+/**
+@brief Move the baselines to a new ambient level
+@details
+Like DetectInit but only the means are replaced. The noise estimates are kept
+so the thresholds do not fall back to the bare margins after a recalibration.
+@param[in] red average ambient red reading
+@param[in] green average ambient green reading
+*/
+extern void DetectReseed(uint16_t red, uint16_t green);
+
+/**
+@brief Load previously saved baselines into the detector
+@details
+Same as DetectInit but keeps the saved noise estimates, used to start detecting
+straight from the values stored in flash.
+@param[in] red red channel baseline
+@param[in] green green channel baseline
+*/
+extern void DetectRestore(const Baseline* red, const Baseline* green);
+
+/**
+@brief Copy out the current baselines so they can be saved
+@details
+Safe to call from the main loop while CheckForHit runs, the copy is taken with
+interrupts disabled.
+@param[out] red red channel baseline
+@param[out] green green channel baseline
+*/
+extern void DetectSnapshot(Baseline* red, Baseline* green);
+
+/**
+@brief Put the detector back in its power-up state
+@details
+Forgets any candidate in progress, the filter and pulse history, the last hit
+and the baselines DetectInit does not seed. Follow with DetectInit or
+DetectRestore. The firmware only ever starts once, this is for host tools that
+run one recording after another through the same detector.
+*/
+extern void DetectReset(void);
+
+/**
+@brief Run one sensor sample through the detector
+@details
+Compare the sample against the current thresholds and timestamp the first
+sample of a hit candidate. When the laser leaves, for more than
+DETECT_DROPOUT_SAMPLES samples, we check that it stayed on target between
+DETECT_HIT_MIN_MS and DETECT_HIT_MAX_MS. If the sample is not part of a hit candidate the baselines are updated
+and the thresholds are recomputed for the next sample.
+@param[in] color sensor reading, blue and clear are only used when
+DETECT_READ_ALL_COLORS is defined
+@param[in] now scheduler time the sample was taken, from TimeNow()
+@return TRUE if the sample completed a valid hit, FALSE otherwise
+*/
+extern uint8_t DetectSample(const ColorReading* color, uint32_t now);
+
+/**
+@brief Check if the detector is tracking a possible hit
+@return TRUE if the last sample was a hit candidate, FALSE otherwise
+*/
+extern uint8_t DetectCandidate(void);
+
+/**
+@brief Get the details of the last accepted hit
+@return pointer to the last hit, valid until the next accepted hit
+*/
+extern const DetectHit* DetectLastHit(void);
+
+#endif // DETECT_H
@@ -0,0 +1,245 @@
+/**
+@file fuse.c
+@brief Fusing several sensors on one target face
+@author Joe Brown
+*/
+#include "global.h"
+#include "fuse.h"
+#include "fixed.h"
+
+#ifdef DETECT_FUSE
+#if DETECT_MODE != DETECT_MODE_THRESHOLD || defined(DETECT_READ_ALL_COLORS)
+#error "DETECT_FUSE needs the THRESHOLD comparator on red and green only"
+#endif
+#if TCS3414_SENSORS > 8
+#error "FuseHit has a bit per sensor"
+#endif
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Locals
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+/** @brief Where a sensor sits on the face */
+typedef struct
+{
+    int8_t x;
+    int8_t y;
+} SensorPosition;
+
+/** @brief Position of each sensor in the order of TCS3414_ADDRESSES, in mm
+from the middle of the face. Any unit works as long as it fits an int8.*/
+static const SensorPosition fuse_sensors[TCS3414_SENSORS] =
+{
+    {-20,   0},
+    { 20,   0}
+};
+
+/** @brief Everything kept per sensor */
+typedef struct
+{
+    uint16_t red;           /**< last reading */
+    uint16_t green;
+    uint32_t red_base;      /**< ambient, DETECT_BASELINE_FRAC fixed point */
+    uint32_t green_base;
+    uint32_t energy;        /**< red excess summed over the candidate */
+} SensorState;
+
+static SensorState sensors[TCS3414_SENSORS];
+/** @brief TRUE from FuseHold to FuseLocate, the sums belong to the accepted hit */
+static uint8_t held = FALSE;
+
+/**
+@brief Move a sensor's ambient level toward a new reading
+@details
+The same asymmetric average the detector uses for its baselines, without the
+noise estimate, which the detector makes on the fused samples.
+*/
+static void Track(uint32_t* base, uint16_t sample);
+
+/**
+@brief Excess weighted mean of one axis
+@param[in] axis 0 for x, 1 for y
+@param[in] shift energies are scaled down by this to keep the products in 32 bits
+@param[in] total sum of the scaled energies
+*/
+static int8_t Centroid(uint8_t axis, uint8_t shift, uint32_t total);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Fusion
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void Track(uint32_t* base, uint16_t sample)
+{
+    uint32_t x = (uint32_t)sample << DETECT_BASELINE_FRAC;
+    if (*base == 0)
+    {
+        *base = x;
+    }
+    if (x > *base)
+    {
+        *base += (x - *base) >> DETECT_BASELINE_RISE_SHIFT;
+    }
+    else
+    {
+        *base -= (*base - x) >> DETECT_BASELINE_FALL_SHIFT;
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void FuseRead(ColorReading* color)
+{
+#ifdef FUSE_ROUND_ROBIN
+    static uint8_t next = 0;
+#endif
+    SensorState* s = NULL;
+    uint8_t learn = !DetectCandidate();
+    uint8_t fresh = TRUE;
+    uint8_t top = 0;
+    uint8_t i = 0;
+    int32_t excess = 0;
+    int32_t best = 0;
+
+    for (i = 0;i < TCS3414_SENSORS;i++)
+    {
+        s = &sensors[i];
+#ifdef FUSE_ROUND_ROBIN
+        fresh = (i == next);
+#endif
+        if (learn && !held)
+        {
+            s->energy = 0;
+        }
+        if (fresh)
+        {
+            Tcs3414Select(i);
+            s->red   = Tcs3414ReadColor(COLOR_RED);
+            s->green = Tcs3414ReadColor(COLOR_GREEN);
+            // Like the detector, leave the ambient alone while the laser
+            // may be on
+            if (learn)
+            {
+                Track(&s->red_base, s->red);
+                Track(&s->green_base, s->green);
+            }
+        }
+        excess = (int32_t)s->red - (int32_t)(s->red_base >> DETECT_BASELINE_FRAC);
+        if (fresh && excess > 0 && !held)
+        {
+            s->energy = FixedAccumulate(s->energy, (uint32_t)excess);
+        }
+        if (i == 0 || excess > best)
+        {
+            best = excess;
+            top = i;
+        }
+    }
+#ifdef FUSE_ROUND_ROBIN
+    if (++next == TCS3414_SENSORS)
+    {
+        next = 0;
+    }
+#endif
+    // Calibration reads the first sensor
+    Tcs3414Select(0);
+
+    // Put the winner on the first sensor's scale
+    excess = (int32_t)(sensors[0].red_base >> DETECT_BASELINE_FRAC) + best;
+    color->red = (excess < 0) ? 0 : FIXED_SAT16((uint32_t)excess);
+    excess = (int32_t)(sensors[0].green_base >> DETECT_BASELINE_FRAC) +
+             (int32_t)sensors[top].green -
+             (int32_t)(sensors[top].green_base >> DETECT_BASELINE_FRAC);
+    color->green = (excess < 0) ? 0 : FIXED_SAT16((uint32_t)excess);
+    color->blue  = 0;
+    color->clear = 0;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void FuseHold(void)
+{
+    held = TRUE;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void FuseLocate(const DetectHit* hit, FuseHit* where)
+{
+    uint32_t total = 0;
+    uint32_t most = 0;
+    uint8_t shift = 0;
+    uint8_t i = 0;
+
+    // Reads after this start summing the next candidate again
+    held = FALSE;
+    memset(where, 0, sizeof(FuseHit));
+    where->confidence = hit->confidence;
+    for (i = 0;i < TCS3414_SENSORS;i++)
+    {
+        total = FixedAccumulate(total, sensors[i].energy);
+        if (sensors[i].energy > most)
+        {
+            most = sensors[i].energy;
+        }
+    }
+    if (most == 0)
+    {
+        return;
+    }
+
+    for (i = 0;i < TCS3414_SENSORS;i++)
+    {
+        if (sensors[i].energy >= (most >> 2))
+        {
+            where->sensors |= _BV(i);
+        }
+    }
+
+    // Keep the sums under 2^24 so weighting by a position fits 32 bits
+    while ((total >> shift) > 0x00FFFFFF)
+    {
+        shift++;
+    }
+    total >>= shift;
+    most >>= shift;
+    if (most == 0)
+    {
+        most = 1;
+    }
+    where->x = Centroid(0, shift, total);
+    where->y = Centroid(1, shift, total);
+    // Light the strongest sensor missed raises the confidence, by up to
+    // TCS3414_SENSORS times when they all caught as much
+    where->confidence = FIXED_SAT8(FixedMul(hit->confidence,
+                                            FIXED_SAT16(FixedDiv(total << 4, most))) >> 4);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t Centroid(uint8_t axis, uint8_t shift, uint32_t total)
+{
+    uint32_t plus = 0;
+    uint32_t minus = 0;
+    uint32_t mean = 0;
+    uint8_t i = 0;
+    int8_t pos = 0;
+    for (i = 0;i < TCS3414_SENSORS;i++)
+    {
+        pos = axis ? fuse_sensors[i].y : fuse_sensors[i].x;
+        if (pos > 0)
+        {
+            plus += FixedMul(sensors[i].energy >> shift, pos);
+        }
+        else
+        {
+            minus += FixedMul(sensors[i].energy >> shift, -pos);
+        }
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+    // The mean lies between the sensors so it fits an int8
+    if (plus >= minus)
+    {
+        mean = FixedDiv(plus - minus, total);
+        return (int8_t)mean;
+    }
+    mean = FixedDiv(minus - plus, total);
+    return -(int8_t)mean;
+}
+#endif // DETECT_FUSE
@@ -0,0 +1,60 @@
+/**
+@file fuse.h
+@brief Definitions for fusing several sensors on one target face
+@author Joe Brown
+*/
+#ifndef FUSE_H
+#define FUSE_H
+
+#include "tcs3414_color_sensor.h"
+#include "detect.h"
+
+/** @brief Where an accepted hit landed and how sure we are of it, from
+FuseLocate */
+typedef struct
+{
+    int8_t  x;              /**< excess weighted position, units of fuse_sensors */
+    int8_t  y;
+    uint8_t sensors;        /**< bit per sensor that caught a quarter of the most light */
+    uint8_t confidence;     /**< DetectHit confidence scaled by total over most light */
+} FuseHit;
+
+/**
+@brief Read the sensors and fuse them into one sample for the detector
+@details
+Reads red and green from every sensor, or from the next one with
+FUSE_ROUND_ROBIN, and tracks each sensor's ambient level the way the detector
+does while the detector is not in a candidate. The output is the first
+sensor's ambient plus the largest red excess over any sensor's own ambient,
+and the green of that sensor the same way, so a laser on any one sensor
+crosses the detector threshold. While a candidate is open each sensor's red
+excess is summed for FuseLocate. Between FuseHold and FuseLocate the sums are
+left alone. Leaves the first sensor selected for calibration.
+@param[out] color fused sample, blue and clear are zero
+*/
+extern void FuseRead(ColorReading* color);
+
+/**
+@brief Keep the sums of the candidate the detector just accepted
+@details
+Call from CheckForHit when DetectSample returns TRUE. Samples taken before the
+target stops detecting then leave the sums alone until FuseLocate has used
+them, so the per-hit math can wait for the main loop.
+*/
+extern void FuseHold(void);
+
+/**
+@brief Work out where a hit landed and how sure we are of it
+@details
+Called once from the main loop after FuseHold, with the sums of the accepted
+candidate. Releases the hold. The position is the mean of the fuse_sensors
+positions weighted by each sensor's summed red excess. The confidence is the
+detector's, which only saw the strongest sensor, times the total excess over
+the strongest sensor's. Costs a FixedMul per sensor and axis and a FixedDiv
+per axis.
+@param[in] hit the detector's view of the hit, as carried with the STUN event
+@param[out] where position and combined confidence
+*/
+extern void FuseLocate(const DetectHit* hit, FuseHit* where);
+
+#endif // FUSE_H
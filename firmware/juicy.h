@@ -1,16 +1,16 @@
-/**
-@file juicy.h
-@brief Definitions for juicy fx
-@author Joe Brown
-*/
-#ifndef JUICY_H
-#define JUICY_H
-
-void JuicyBlueOn(void);
-void JuicyBlueOff(void);
-void JuicyRedOn(void);
-void JuicyRedOff(void);
-void JuicyBothOn(void);
-void JuicyBothOff(void);
-
-#endif
+/**
+@file juicy.h
+@brief Definitions for juicy fx
+@author Joe Brown
+*/
+#ifndef JUICY_H
+#define JUICY_H
+
+void JuicyBlueOn(void);
+void JuicyBlueOff(void);
+void JuicyRedOn(void);
+void JuicyRedOff(void);
+void JuicyBothOn(void);
+void JuicyBothOff(void);
+
+#endif
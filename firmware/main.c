@@ -1,312 +1,447 @@
-#include "global.h"
-#include "hw.h"
-#include "schedule.h"
-#include "clock.h"
-#include "delay.h"
-#include "hardware_init.h"
-#include "interrupt.h"
-#include "state.h"
-#include "tcs3414_color_sensor.h"
-#include "juicy.h"
-
-// One target needs pullups enabled for the set/cnt lines
-//#define ENABLE_PULLUPS
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-//                        Locals and State Machine config
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-StateMachine s;
-
-enum Event
-{
-    DEFAULT_EVENTS, // Enter, idle, exit
-    STUN,           // Verified laser hit
-    STUN_TIMEOUT,   // Timeout from hit delay
-    CONFIG,         // Hit detected by another target or target reset
-    CNT_TICK,       // CNT tick to tell us how many hits to use
-    KILL            // When stuns >= kill count
-};
-
-void Detecting(uint8_t ev);
-void Config(uint8_t ev);
-void Stunned(uint8_t ev);
-void Dead(uint8_t ev);
-
-
-const Transition rules[] =
-{
-//  Current State + Event         = New State
-    {Detecting,     STUN,           Stunned},
-    {Detecting,     CONFIG,         Config},
-    {Config,        CONFIG,         Detecting},
-    {Config,        KILL,           Dead},
-    {Stunned,       STUN_TIMEOUT,   Detecting},
-    {Stunned,       KILL,           Dead},
-    {Dead,          CONFIG,         Config}
-};
-
-static uint8_t kill_count = 0xFF;
-
-static uint16_t red_thresh = 0;
-static uint16_t green_thresh = 0;
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-//                              Utilities
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-void HwInit(void)
-{
-    // LEDs
-    HW_OUTPUT(RED);
-    RED_OFF();
-    HW_OUTPUT(BLUE);
-    BLUE_OFF();
-
-    // TCS3414
-    HW_OUTPUT(SYNC);
-    SYNC_LOW();
-
-    // Intermodule Communication
-    HW_INPUT(SET);
-    HW_INPUT(CNT);
-#ifdef ENABLE_PULLUPS
-    HW_PULL_UP(SET);
-    HW_PULL_UP(CNT);
-#endif
-}
-
-void RecordAmbientLight(uint8_t num_samples)
-{
-    uint8_t i = 0;
-    uint16_t red_sum = 0;
-    uint16_t green_sum = 0;
-    Delay(500); // wait for it to settle after init
-    for (i = 0;i < num_samples;i++)
-    {
-        red_sum += Tcs3414ReadColor(COLOR_RED);
-        green_sum += Tcs3414ReadColor(COLOR_GREEN);
-        Delay(100);
-    }
-    red_thresh = ((red_sum / num_samples) * 15) / 10;
-    green_thresh = ((green_sum / num_samples) * 12) / 10;
-}
-
-void BroadcastHit(void)
-{
-    // Pull the set line low
-    HW_OUTPUT(SET);
-    HW_SET_LOW(SET);
-}
-
-void BroadcastReset(void)
-{
-    // Toggle high->low->high to force a CONFIG event on other targets
-    HW_SET_HIGH(SET);
-    Delay(150);
-    HW_SET_LOW(SET);
-    Delay(150);
-    // Return to input/pullup state
-    HW_SET_HIGH(SET);
-    HW_INPUT(SET);
-}
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-//                              Signal generators
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-void CheckForHit(void)
-{
-    static uint32_t laser_hit_count = 0;
-    uint16_t red   = Tcs3414ReadColor(COLOR_RED);
-    uint16_t green = Tcs3414ReadColor(COLOR_GREEN);
-    uint8_t hit = (red > red_thresh) && (green < green_thresh);
-    if (hit)
-    {
-        laser_hit_count++;
-    }
-    else
-    {
-        if (laser_hit_count >= 9 && laser_hit_count < 22) //450-1100ms
-        {
-            StateMachinePublishEvent(&s,STUN);
-        }
-        laser_hit_count = 0;
-    }
-}
-
-void SetPoll(void)
-{
-    static uint8_t toggle = 0;
-    uint8_t down = !SET_READ();
-    if (down && !toggle)
-    {
-        if (s.state == Config && kill_count == 0)
-        {
-            StateMachinePublishEvent(&s, KILL);
-        }
-        else
-        {
-            StateMachinePublishEvent(&s, CONFIG);
-        }
-        toggle = 1;
-    }
-    else if (!down && toggle)
-    {
-        toggle = 0;
-    }
-}
-
-void CntPoll(void)
-{
-    static uint8_t toggle = 0;
-    uint8_t down = !CNT_READ();
-    if (down && !toggle)
-    {
-        StateMachinePublishEvent(&s,CNT_TICK);
-        toggle = 1;
-    }
-    else if (!down && toggle)
-    {
-        toggle = 0;
-    }
-}
-
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-//                             State functions
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-void Detecting(uint8_t ev)
-{
-    switch (ev)
-    {
-        case ENTER:
-        {
-            CallbackMode(CheckForHit,ENABLED);
-            CallbackMode(SetPoll,ENABLED);
-            JuicyBlueOn();
-            break;
-        }
-        case EXIT:
-        {
-            CallbackMode(CheckForHit,DISABLED);
-            CallbackMode(SetPoll,DISABLED);
-            break;
-        }
-    }
-}
-
-void Config(uint8_t ev)
-{
-    static uint8_t cnt_state = 0;
-    switch (ev)
-    {
-        case ENTER:
-        {
-            if (kill_count)
-            {
-                JuicyBlueOff();
-            }
-            CallbackMode(CntPoll,ENABLED);
-            CallbackMode(SetPoll,ENABLED);
-            break;
-        }
-        case CNT_TICK:
-        {
-            if (cnt_state == 0)
-            {
-                cnt_state = 1;
-                kill_count = 1;
-            }
-            else
-            {
-                kill_count++;
-            }
-            uint8_t i = kill_count;
-            while (i--)
-            {
-                JuicyBothOn();
-                JuicyBothOff();
-            }
-            break;
-        }
-        case EXIT:
-        {
-            CallbackMode(CntPoll,DISABLED);
-            CallbackMode(SetPoll,DISABLED);
-            cnt_state = 0;
-            break;
-        }
-    }
-}
-
-void Stunned(uint8_t ev)
-{
-    switch (ev)
-    {
-        case ENTER:
-        {
-            BroadcastHit();
-            JuicyBlueOff();
-            JuicyRedOn();
-            Tcs3414Shutdown();
-            kill_count--;
-            break;
-        }
-        case IDLE:
-        {
-            Delay(1000);
-            StateMachinePublishEvent(&s, kill_count ? STUN_TIMEOUT : KILL);
-            break;
-        }
-        case EXIT:
-        {
-            BroadcastReset();
-            Tcs3414Init();
-            JuicyRedOff();
-            break;
-        }
-    }
-}
-
-void Dead(uint8_t ev)
-{
-    switch (ev)
-    {
-        case ENTER:
-        {
-            CallbackMode(SetPoll,ENABLED);
-            Tcs3414Shutdown();
-            break;
-        }
-        case EXIT:
-        {
-            CallbackMode(SetPoll,DISABLED);
-            Tcs3414Init();
-            break;
-        }
-    }
-}
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-//                                  Entry
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-void main(void)
-{
-
-    WD_STOP();
-    ClockConfig(8);
-    ScheduleTimerInit();
-    HwInit();
-    Tcs3414Init();
-    s = StateMachineCreate(rules,sizeof(rules), Detecting);
-    _EINT();
-    JuicyBlueOn();
-    RecordAmbientLight(25);
-    JuicyBlueOff();
-    Delay(1000);
-    CallbackRegister(CheckForHit,50);
-    CallbackRegister(CntPoll,100);
-    CallbackRegister(SetPoll,100);
-    while (1)
-    {
-        StateMachineRun(&s);
-    }
-}
+#include "global.h"
+#include "hw.h"
+#include "schedule.h"
+#include "clock.h"
+#include "delay.h"
+#include "hardware_init.h"
+#include "interrupt.h"
+#include "state.h"
+#include "tcs3414_color_sensor.h"
+#include "juicy.h"
+#include "detect.h"
+#include "calibrate.h"
+#include "stats.h"
+#include "capture.h"
+#include "decimate.h"
+#include "fuse.h"
+#include "fixed.h"
+
+// One target needs pullups enabled for the set/cnt lines
+//#define ENABLE_PULLUPS
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                        Locals and State Machine config
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+StateMachine s;
+
+enum Event
+{
+    DEFAULT_EVENTS, // Enter, idle, exit
+    STUN,           // Verified laser hit
+    STUN_TIMEOUT,   // Timeout from hit delay
+    CONFIG,         // Hit detected by another target or target reset
+    CNT_TICK,       // CNT tick to tell us how many hits to use
+    KILL            // When stuns >= kill count
+};
+
+void Detecting(uint8_t ev);
+void Config(uint8_t ev);
+void Stunned(uint8_t ev);
+void Dead(uint8_t ev);
+
+
+const Transition rules[] =
+{
+//  Current State + Event         = New State
+    {Detecting,     STUN,           Stunned},
+    {Detecting,     CONFIG,         Config},
+    {Config,        CONFIG,         Detecting},
+    {Config,        KILL,           Dead},
+    {Stunned,       STUN_TIMEOUT,   Detecting},
+    {Stunned,       KILL,           Dead},
+    {Dead,          CONFIG,         Config}
+};
+
+static uint8_t kill_count = 0xFF;
+
+/** @brief What the detector made of the hit behind the STUN event, latched by
+CheckForHit as it publishes STUN since the event itself is only a code. The
+Stunned state reads it.*/
+static DetectHit stun_hit;
+#ifdef DETECT_FUSE
+/** @brief Where that hit landed, worked out when Stunned is entered */
+static FuseHit stun_where;
+#endif
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                              Utilities
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void HwInit(void)
+{
+    // LEDs
+    HW_OUTPUT(RED);
+    RED_OFF();
+    HW_OUTPUT(BLUE);
+    BLUE_OFF();
+
+    // TCS3414
+    HW_OUTPUT(SYNC);
+    SYNC_LOW();
+
+    // Intermodule Communication
+    HW_INPUT(SET);
+    HW_INPUT(CNT);
+#ifdef ENABLE_PULLUPS
+    HW_PULL_UP(SET);
+    HW_PULL_UP(CNT);
+#endif
+}
+
+void RecordAmbientLight(uint8_t samples_shift)
+{
+    uint8_t i = 0;
+    uint16_t red = 0;
+    uint16_t green = 0;
+    uint32_t red_sum = 0;
+    uint32_t green_sum = 0;
+    Delay(500); // wait for it to settle after init
+    // power of two sample count so the mean is a shift
+    for (i = 0;i < _BV(samples_shift);i++)
+    {
+        red = Tcs3414ReadColor(COLOR_RED);
+        green = Tcs3414ReadColor(COLOR_GREEN);
+        red_sum = FixedAccumulate(red_sum, red);
+        green_sum = FixedAccumulate(green_sum, green);
+        Delay(100);
+    }
+    DetectInit(FIXED_MEAN(red_sum, samples_shift),
+               FIXED_MEAN(green_sum, samples_shift));
+}
+
+uint8_t ReadSample(ColorReading* color)
+{
+    // The first integration after Tcs3414Init is not finished yet, reading
+    // it would seed the baselines with zero
+    if (!Tcs3414Ready())
+    {
+        return FALSE;
+    }
+#ifdef DETECT_FUSE
+    FuseRead(color);
+#elif defined(DETECT_READ_ALL_COLORS)
+    *color = Tcs3414ReadAllColors();
+#else
+    color->red   = Tcs3414ReadColor(COLOR_RED);
+    color->green = Tcs3414ReadColor(COLOR_GREEN);
+#endif
+#ifdef DETECT_DECIMATE
+    return DecimateSample(color);
+#else
+    return TRUE;
+#endif
+}
+
+#ifdef DETECT_CAPTURE
+void CaptureHit(void)
+{
+    ColorReading color;
+    uint32_t now = 0;
+    // Bounded in case the sensor stops answering
+    uint8_t reads = CAPTURE_POST * (DETECT_PERIOD_MS / DETECT_READ_MS);
+    // CheckForHit is off now, read the rest of the post-trigger samples at
+    // the same rate before the sensor is shut down
+    while (CaptureFilling() && reads--)
+    {
+        Delay(DETECT_READ_MS);
+        now = TimeNow();
+        if (ReadSample(&color))
+        {
+            CaptureRecord(&color, now);
+        }
+    }
+#ifdef DETECT_FUSE
+    CaptureReport(&stun_hit, &stun_where);
+#else
+    CaptureReport(&stun_hit, NULL);
+#endif
+    CaptureDump();
+}
+#endif
+
+void BroadcastHit(void)
+{
+    // Pull the set line low
+    HW_OUTPUT(SET);
+    HW_SET_LOW(SET);
+}
+
+void BroadcastReset(void)
+{
+    // Toggle high->low->high to force a CONFIG event on other targets
+    HW_SET_HIGH(SET);
+    Delay(150);
+    HW_SET_LOW(SET);
+    Delay(150);
+    // Return to input/pullup state
+    HW_SET_HIGH(SET);
+    HW_INPUT(SET);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                              Signal generators
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CheckForHit(void)
+{
+    // Stamp the sample when it was due, before the sensor reads, so how long
+    // they take does not show up as jitter in the hit timing
+    uint32_t now = TimeNow();
+    ColorReading color;
+    if (!ReadSample(&color))
+    {
+        return;
+    }
+#ifdef DETECT_CAPTURE
+    CaptureRecord(&color, now);
+#endif
+    if (DetectSample(&color, now))
+    {
+#ifdef DETECT_FUSE
+        // Locating it is once per hit math, leave it to the Stunned state
+        FuseHold();
+#endif
+        // Peak, energy, confidence, shooter and color go with the event
+        stun_hit = *DetectLastHit();
+        StateMachinePublishEvent(&s,STUN);
+    }
+    // Background recalibration averages the same samples
+    CalibrateSample(&color, now);
+}
+
+void SetPoll(void)
+{
+    static uint8_t toggle = 0;
+    uint8_t down = !SET_READ();
+    if (down && !toggle)
+    {
+        if (s.state == Config && kill_count == 0)
+        {
+            StateMachinePublishEvent(&s, KILL);
+        }
+        else
+        {
+            StateMachinePublishEvent(&s, CONFIG);
+        }
+        toggle = 1;
+    }
+    else if (!down && toggle)
+    {
+        toggle = 0;
+    }
+}
+
+void CntPoll(void)
+{
+    static uint8_t toggle = 0;
+    uint8_t down = !CNT_READ();
+    if (down && !toggle)
+    {
+        StateMachinePublishEvent(&s,CNT_TICK);
+        toggle = 1;
+    }
+    else if (!down && toggle)
+    {
+        toggle = 0;
+    }
+}
+
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                             State functions
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void Detecting(uint8_t ev)
+{
+    switch (ev)
+    {
+        case ENTER:
+        {
+#ifdef DETECT_DECIMATE
+            // Reads from before a stun or Config are stale
+            DecimateReset();
+#endif
+            CallbackMode(CheckForHit,ENABLED);
+            CallbackMode(SetPoll,ENABLED);
+            CallbackMode(CntPoll,ENABLED);
+            JuicyBlueOn();
+            break;
+        }
+        case IDLE:
+        {
+            CalibrateCommit();
+            break;
+        }
+        case CNT_TICK:
+        {
+            // A CNT pulse while detecting asks for a fresh ambient reading
+            CalibrateStart();
+            break;
+        }
+        case EXIT:
+        {
+            CallbackMode(CheckForHit,DISABLED);
+            CallbackMode(SetPoll,DISABLED);
+            CallbackMode(CntPoll,DISABLED);
+            break;
+        }
+    }
+}
+
+void Config(uint8_t ev)
+{
+    static uint8_t cnt_state = 0;
+    switch (ev)
+    {
+        case ENTER:
+        {
+            if (kill_count)
+            {
+                JuicyBlueOff();
+            }
+#ifdef DETECT_STATS
+            StatsDump();
+#endif
+#ifdef DETECT_CAPTURE
+            CaptureDump();
+#endif
+            CallbackMode(CntPoll,ENABLED);
+            CallbackMode(SetPoll,ENABLED);
+            break;
+        }
+        case CNT_TICK:
+        {
+            if (cnt_state == 0)
+            {
+                cnt_state = 1;
+                kill_count = 1;
+            }
+            else
+            {
+                kill_count++;
+            }
+            uint8_t i = kill_count;
+            while (i--)
+            {
+                JuicyBothOn();
+                JuicyBothOff();
+            }
+            break;
+        }
+        case EXIT:
+        {
+            CallbackMode(CntPoll,DISABLED);
+            CallbackMode(SetPoll,DISABLED);
+            cnt_state = 0;
+            // The lighting may have changed since we last looked, pick it
+            // up in the background once we are detecting again
+            CalibrateStart();
+            break;
+        }
+    }
+}
+
+void Stunned(uint8_t ev)
+{
+    switch (ev)
+    {
+        case ENTER:
+        {
+#ifdef DETECT_FUSE
+            // Where it landed and the confidence over all the sensors
+            FuseLocate(&stun_hit, &stun_where);
+#endif
+            BroadcastHit();
+#ifdef DETECT_CAPTURE
+            // Log the hit with what the sensor saw of it, before our own
+            // LEDs change the light
+            CaptureHit();
+#endif
+            JuicyBlueOff();
+            JuicyRedOn();
+            Tcs3414Shutdown();
+            kill_count--;
+            break;
+        }
+        case IDLE:
+        {
+            Delay(1000);
+            StateMachinePublishEvent(&s, kill_count ? STUN_TIMEOUT : KILL);
+            break;
+        }
+        case EXIT:
+        {
+            BroadcastReset();
+            Tcs3414Init();
+            JuicyRedOff();
+            break;
+        }
+    }
+}
+
+void Dead(uint8_t ev)
+{
+    switch (ev)
+    {
+        case ENTER:
+        {
+            CallbackMode(SetPoll,ENABLED);
+            Tcs3414Shutdown();
+            break;
+        }
+        case EXIT:
+        {
+            CallbackMode(SetPoll,DISABLED);
+            Tcs3414Init();
+            break;
+        }
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Entry
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void main(void)
+{
+
+    WD_STOP();
+    ClockConfig(8);
+    ScheduleTimerInit();
+    HwInit();
+    Tcs3414Init();
+#ifdef DETECT_STATS
+    StatsInit();
+#endif
+    s = StateMachineCreate(rules,sizeof(rules)/sizeof(rules[0]), Detecting);
+    _EINT();
+    if (CalibrateLoad() == SUCCESS)
+    {
+        // Start detecting right away on the saved thresholds and refine
+        // them in the background
+        CalibrateStart();
+    }
+    else
+    {
+        JuicyBlueOn();
+        RecordAmbientLight(CALIBRATE_SAMPLES_SHIFT);
+        CalibrateSave();
+        JuicyBlueOff();
+        Delay(1000);
+    }
+    // First in the store so it runs first when callbacks fall on the same tick
+    CallbackRegister(CheckForHit,DETECT_READ_MS);
+    CallbackRegister(CntPoll,100);
+    CallbackRegister(SetPoll,100);
+    while (1)
+    {
+#ifdef SCHEDULE_TICKLESS
+        // With nothing queued the state gets its IDLE pass. If that queues
+        // nothing either, sleep until a callback may have.
+        uint8_t idle = (s.event_cnt == 0);
+        StateMachineRun(&s);
+        if (idle && s.event_cnt == 0)
+        {
+            ScheduleSleep();
+        }
+#else
+        StateMachineRun(&s);
+#endif
+    }
+}
@@ -1,15 +1,15 @@
-/**
-@file clock.h
-@brief Definitions for clock config helper macros
-@author Joe Brown
-*/
-#ifndef CLOCK_H
-#define CLOCK_H
-
-/**
-@brief Configure the clocks for use
-@param[in] mhz the clock speed
-*/
-extern void ClockConfig(uint8_t mhz);
-
-#endif
+/**
+@file clock.h
+@brief Definitions for clock config helper macros
+@author Joe Brown
+*/
+#ifndef CLOCK_H
+#define CLOCK_H
+
+/**
+@brief Configure the clocks for use
+@param[in] mhz the clock speed
+*/
+extern void ClockConfig(uint8_t mhz);
+
+#endif
@@ -1,35 +1,293 @@
-/**
-@file lib_config.h
-@brief Definitions that change the settings of launchlib libraries
-@author Joe Brown
-*/
-#ifndef CONFIG_H
-#define CONFIG_H
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-//           _____        __               __        __
-//          / ___/ _____ / /_   ___   ____/ /__  __ / /___   _____
-//          \__ \ / ___// __ \ / _ \ / __  // / / // // _ \ / ___/
-//         ___/ // /__ / / / //  __// /_/ // /_/ // //  __// /
-//        /____/ \___//_/ /_/ \___/ \__,_/ \__,_//_/ \___//_/
-//
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-// If you change the clock it will mess up the scheduler timing. To deal with
-// this you can define ADJUST_SCHEDULER_ON_CLOCK_CONFIG. This will readjust
-// the scheduler every time the clock is changed. If you never plan on changing
-// the clock during runtime you do not need to enable this.
-//#define ADJUST_SCHEDULER_ON_CLOCK_CONFIG
-#define MAX_CALLBACK_CNT    3
-#define MAX_CALLOUT_CNT     1
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-//    _____  __          __           __  ___              __     _
-//   / ___/ / /_ ____ _ / /_ ___     /  |/  /____ _ _____ / /_   (_)____   ___
-//   \__ \ / __// __ `// __// _ \   / /|_/ // __ `// ___// __ \ / // __ \ / _ \
-//  ___/ // /_ / /_/ // /_ /  __/  / /  / // /_/ // /__ / / / // // / / //  __/
-// /____/ \__/ \__,_/ \__/ \___/  /_/  /_/ \__,_/ \___//_/ /_//_//_/ /_/ \___/
-//
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-#define MAX_EVENT_CNT       10
-
-#endif
+/**
+@file lib_config.h
+@brief Definitions that change the settings of launchlib libraries
+@author Joe Brown
+*/
+#ifndef CONFIG_H
+#define CONFIG_H
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//           _____        __               __        __
+//          / ___/ _____ / /_   ___   ____/ /__  __ / /___   _____
+//          \__ \ / ___// __ \ / _ \ / __  // / / // // _ \ / ___/
+//         ___/ // /__ / / / //  __// /_/ // /_/ // //  __// /
+//        /____/ \___//_/ /_/ \___/ \__,_/ \__,_//_/ \___//_/
+//
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+// If you change the clock it will mess up the scheduler timing. To deal with
+// this you can define ADJUST_SCHEDULER_ON_CLOCK_CONFIG. This will readjust
+// the scheduler every time the clock is changed. If you never plan on changing
+// the clock during runtime you do not need to enable this.
+//#define ADJUST_SCHEDULER_ON_CLOCK_CONFIG
+// Scheduler tick in microseconds. TimerA interrupts once per tick and every
+// callback and callout time is a whole number of ticks, so this must divide
+// 1000. Shorter ticks give finer timing at the cost of more interrupts.
+#define SCHEDULE_TICK_US    1000
+// Tickless scheduler. TimerA counts ACLK and only interrupts when a callback
+// or callout is due, and the main loop sleeps in LPM3 in between, so the CPU
+// and DCO are off between samples. A tick is then one ACLK cycle and
+// SCHEDULE_TICK_US is not used. This board has no crystal on XIN/XOUT so ACLK
+// comes from the VLO, which runs anywhere from 4 to 20kHz. ScheduleTimerInit
+// times it against the calibrated DCO at boot and converts ms with what it
+// found, SCHEDULE_ACLK_HZ is only the nominal rate the host tools use. It
+// still drifts a little with temperature and supply after boot. Define
+// SCHEDULE_ACLK_CRYSTAL on a board with a 32768Hz watch crystal fitted,
+// without one it hangs at boot waiting for the crystal to start.
+//#define SCHEDULE_TICKLESS
+//#define SCHEDULE_ACLK_CRYSTAL
+#ifndef SCHEDULE_ACLK_CRYSTAL
+#define SCHEDULE_ACLK_VLO
+#endif
+#ifdef SCHEDULE_ACLK_VLO
+#define SCHEDULE_ACLK_HZ    12000
+#else
+#define SCHEDULE_ACLK_HZ    32768
+#endif
+#define MAX_CALLBACK_CNT    3
+#define MAX_CALLOUT_CNT     1
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//    _____  __          __           __  ___              __     _
+//   / ___/ / /_ ____ _ / /_ ___     /  |/  /____ _ _____ / /_   (_)____   ___
+//   \__ \ / __// __ `// __// _ \   / /|_/ // __ `// ___// __ \ / // __ \ / _ \
+//  ___/ // /_ / /_/ // /_ /  __/  / /  / // /_/ // /__ / / / // // / / //  __/
+// /____/ \__/ \__,_/ \__/ \___/  /_/  /_/ \__,_/ \___//_/ /_//_//_/ /_/ \___/
+//
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+#define MAX_EVENT_CNT       10
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                              __
+//                             / /   ____ _ _____ ___   _____
+//                            / /   / __ `// ___// _ \ / ___/
+//                           / /___/ /_/ /(__  )/  __// /
+//                          /_____/\__,_//____/ \___//_/
+//
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+// Hit comparator selection. THRESHOLD compares red and green against their
+// baselines. CHROMA uses red, green and blue as fractions of the clear channel
+// so white light and laser distance do not change the decision. CHROMA reads
+// all four channels every sample. GOERTZEL looks for a laser chopped at a known
+// frequency in the red channel and ignores steady light. CLASSIFY reads all four
+// channels and accepts red, green or blue lasers, reporting which one hit as
+// DetectHit color with the STUN event.
+#define DETECT_MODE_THRESHOLD       0
+#define DETECT_MODE_CHROMA          1
+#define DETECT_MODE_GOERTZEL        2
+#define DETECT_MODE_CLASSIFY        3
+#define DETECT_MODE                 DETECT_MODE_THRESHOLD
+
+// Targets riding the train only have the beam on them for as long as it takes
+// to go past. DETECT_FAST trades sensitivity for time resolution: the TCS3414
+// integrates for 12ms instead of 100ms (at 16x gain instead of 4x to win some
+// of the counts back), CheckForHit runs every 15ms instead of 50ms and much
+// shorter hits count. The period must stay longer than the integration time or
+// the same reading is taken twice.
+//#define DETECT_FAST
+
+// Uncomment to read the sensor 2^DECIMATE_SHIFT times per detector sample and
+// hand the detector one filtered sample per DETECT_PERIOD_MS. Shorter
+// integration is noisier and the noise pushes the thresholds up, this buys some
+// of the sensitivity back for time resolution. The filter is an integer CIC of
+// DECIMATE_ORDER stages: 1 is a plain boxcar mean of the reads, 2 rejects
+// flicker between the detector samples better but spreads each read over two
+// of them. Each stage costs 8 bytes of RAM per channel read and the detector
+// sees a step about DECIMATE_ORDER / 2 detector samples late. Meant for
+// DETECT_FAST, where every read is a fresh 12ms conversion; with the 100ms one
+// reads every 50ms already overlap. DECIMATE_ORDER * DECIMATE_SHIFT at most 16.
+//#define DETECT_DECIMATE
+#define DECIMATE_SHIFT              1
+#define DECIMATE_ORDER              1
+
+// Uncomment to read several sensors on one face and fuse them into the one
+// sample the detector sees. Each sensor keeps its own ambient level and the
+// detector gets red from whichever sensor sees the most over its own ambient
+// (any of them can score a hit), with that sensor's green, on the scale of the
+// first sensor. Over a candidate the red excess of each sensor is summed and
+// an accepted hit gets the excess weighted position of the sensors from
+// fuse_sensors in fuse.c, and a confidence raised by the share of the light
+// the other sensors caught. With FUSE_ROUND_ROBIN one sensor is read per
+// CheckForHit and the others keep their last reading, otherwise all are read
+// every time. THRESHOLD comparator only. 16 bytes of RAM per sensor.
+//
+// The sensors answer at TCS3414_ADDRESSES, one per sensor, and the first is
+// the one calibration reads. Every part on the bus needs its own address, set
+// these to the parts fitted to the board.
+//#define DETECT_FUSE
+//#define FUSE_ROUND_ROBIN
+#ifdef DETECT_FUSE
+#define TCS3414_SENSORS             2
+#define TCS3414_ADDRESSES           0x39, 0x29
+#else
+#define TCS3414_SENSORS             1
+#define TCS3414_ADDRESSES           0x39
+#endif
+
+// A valid hit keeps the laser on target for at least DETECT_HIT_MIN_MS and less
+// than DETECT_HIT_MAX_MS, timed from the first sample above threshold to the
+// first one below it. These do not depend on the sample period.
+//
+// A spot skating over a moving sensor flickers in and out. A candidate lives
+// through up to DETECT_DROPOUT_SAMPLES samples in a row without the laser and
+// is timed to the first of them, so a hit is reported that many samples late.
+// With 0 the first sample without the laser ends it.
+#ifdef DETECT_FAST
+#define DETECT_READ_MS              15
+#define DETECT_HIT_MIN_MS           90
+#define DETECT_DROPOUT_SAMPLES      2
+#else
+#define DETECT_READ_MS              50
+#define DETECT_HIT_MIN_MS           450
+#define DETECT_DROPOUT_SAMPLES      0
+#endif
+#define DETECT_HIT_MAX_MS           1100
+// CheckForHit reads the sensor every DETECT_READ_MS, the detector gets a sample
+// every DETECT_PERIOD_MS
+#ifdef DETECT_DECIMATE
+#define DETECT_PERIOD_MS            (DETECT_READ_MS << DECIMATE_SHIFT)
+#else
+#define DETECT_PERIOD_MS            DETECT_READ_MS
+#endif
+
+// The ambient level of each channel is tracked with an exponential moving
+// average kept in fixed point with DETECT_BASELINE_FRAC fractional bits. The
+// average follows a rising channel slowly (1/2^RISE per sample) so a laser
+// parked on the sensor is not absorbed into the baseline, and a falling channel
+// quickly (1/2^FALL per sample) so dimming lights do not leave us blind. The
+// shifts count samples so fast mode uses longer ones to keep about the same
+// time constants.
+#define DETECT_BASELINE_FRAC        8
+#ifdef DETECT_FAST
+#define DETECT_BASELINE_RISE_SHIFT  8
+#define DETECT_BASELINE_FALL_SHIFT  5
+#else
+#define DETECT_BASELINE_RISE_SHIFT  6
+#define DETECT_BASELINE_FALL_SHIFT  3
+#endif
+// The noise estimate is an average of |sample - baseline| over 2^SHIFT samples
+#define DETECT_NOISE_SHIFT          4
+// Thresholds are the baseline plus MARGIN/16 of it (1.5x for red, ~1.2x for
+// green) plus the noise estimate scaled by 2^GAIN. MARGIN goes from 0 to 16.
+#define DETECT_RED_MARGIN           8
+#define DETECT_GREEN_MARGIN         3
+#define DETECT_RED_NOISE_GAIN       2
+#define DETECT_GREEN_NOISE_GAIN     2
+// Uncomment to place the red threshold from what the hits look like instead of
+// the fixed margin. Next to the ambient baseline, the background cluster, the
+// detector learns the mean and deviation of the red excess in hits, the hit
+// cluster, 1/2^LEARN_SHIFT per sample and only from candidates that were
+// accepted, so rejected and doubtful samples never move it. Once
+// LEARN_MIN_HITS hits are in the threshold sits where a sample is as many
+// deviations from one cluster as from the other, at most halfway to the hit
+// mean and never under the noise scaled by 2^DETECT_RED_NOISE_GAIN. THRESHOLD
+// comparator only, green stays a ceiling. The hit cluster is not saved with
+// the calibration and is learned again after power up. 19 bytes of RAM.
+//#define DETECT_LEARN
+#define LEARN_SHIFT                 3
+#define LEARN_MIN_HITS              3
+#define LEARN_FLOOR_MARGIN          2
+// Chromaticity bounds in 16ths of the clear channel. A laser hit must push red
+// to at least RED_MIN/16 of clear while green and blue stay under their max.
+// Samples with clear below CLEAR_MIN are too dark to judge and never hit.
+#define DETECT_CHROMA_RED_MIN       9
+#define DETECT_CHROMA_GREEN_MAX     4
+#define DETECT_CHROMA_BLUE_MAX      4
+#define DETECT_CHROMA_CLEAR_MIN     64
+
+// Uncomment to decode shooter IDs from lasers chopped with an on/off code (see
+// pulse_codes in detect.c). One code bit per sample, so the sample period must
+// match the bit time and the integration time must be shorter than it. The
+// laser is treated as present until PULSE_GAP_SAMPLES samples in a row are
+// off, which must be longer than the longest off run in any code. The hit
+// window is then measured to the end of that gap. The decoded ID goes out with
+// the STUN event as DetectHit shooter, 0 when no code matched.
+//#define DETECT_PULSE_CODE
+#define PULSE_GAP_SAMPLES           5
+
+// Uncomment to reject camera flashes and strobes by the shape of the candidate.
+// Only for the red THRESHOLD and CHROMA comparators, and reads all four
+// channels. A candidate is thrown out if any of its samples:
+//  - has more excess red over baseline than FLASH_MAX_EXCESS
+//  - is the FLASH_DROOP_SAMPLES'th in a row under 1/2^FLASH_DROOP_SHIFT of the
+//    peak excess while still on
+//  - has blue excess over 1/2^FLASH_BLUE_SHIFT of the red excess
+//  - has clear excess over 2^FLASH_CLEAR_SHIFT times the red excess
+// Blue and clear excess are over levels that move 1/2^FLASH_AMBIENT_SHIFT of
+// the way to each ambient sample, so they keep up with a moving target.
+// or if the sample that ends it follows a drooped one and still has more than
+// 1/2^FLASH_TAIL_SHIFT of the peak excess (a flash fades out over several
+// samples). The integration time is longer than the sample period, so a laser
+// edge leaves one partial sample under half the plateau and the droop and tail
+// rules allow one on each edge. A spot swept slowly off the sensor fades like a
+// flash though, so for targets that move past the laser set FLASH_DROOP_SAMPLES
+// to 0 to keep only the brightness and color rules.
+//#define DETECT_FLASH_REJECT
+#define FLASH_MAX_EXCESS            40000
+#define FLASH_DROOP_SHIFT           1
+#define FLASH_DROOP_SAMPLES         3
+#define FLASH_TAIL_SHIFT            3
+#define FLASH_BLUE_SHIFT            2
+#define FLASH_CLEAR_SHIFT           2
+#define FLASH_AMBIENT_SHIFT         2
+
+// Uncomment to count hit candidates and histogram their length in RAM. The
+// statistics are dumped to information flash each time the target enters
+// Config. STATS_BINS bins of STATS_BIN_MS each, the last bin is open ended.
+//#define DETECT_STATS
+#define STATS_BINS                  8
+#define STATS_BIN_MS                200
+
+// Uncomment to keep the samples around a hit candidate for when a hit is
+// disputed. CAPTURE_PRE samples up to the one that opens the candidate and
+// CAPTURE_POST from the one that closes it are held in RAM, 6 bytes a sample
+// plus 16 (20 with DETECT_FUSE) for the header and the details of an accepted
+// hit, and another 6 per CAPTURE_PRE for the running pre-trigger ring, and
+// written to information flash when the target is stunned or enters Config.
+// A stun reads the rest of the post-trigger samples before it writes them, so
+// the stun LEDs come on (CAPTURE_POST - 1) samples later. The newest candidate
+// is kept, except that an accepted one is never replaced before it is written.
+//#define DETECT_CAPTURE
+#define CAPTURE_PRE                 3
+#define CAPTURE_POST                2
+
+// Classify mode needs clear above its baseline plus MARGIN/16 of it (1.25x)
+// plus noise scaled by 2^GAIN, then matches the sample against the
+// laser_signatures table in detect.c. The candidate takes the class of its
+// brightest sample.
+#define DETECT_CLEAR_MARGIN         4
+#define DETECT_CLEAR_NOISE_GAIN     2
+
+// Goertzel mode expects the laser chopped at exactly a quarter of the sample
+// rate (on,on,off,off) so the filter coefficient is zero and needs no multiply.
+// The filter runs over blocks of 2^GOERTZEL_BLOCK_SHIFT samples. A block is a
+// hit when the magnitude at the chop frequency is at least 1/2^DC_SHIFT of the
+// block's total red and at least GOERTZEL_MIN_LEVEL counts per sample. The
+// laser has to cover a whole aligned block inside the hit window, so the block
+// is the longest of 16, 8 or 4 samples that lasts no more than half of
+// DETECT_HIT_MIN_MS at DETECT_PERIOD_MS. That is 4 samples (200ms) at the
+// default 50ms. 4 samples is one chop cycle and the least that works, detect.c
+// stops the build if even that is too long.
+#if (DETECT_PERIOD_MS << 4) <= (DETECT_HIT_MIN_MS / 2)
+#define GOERTZEL_BLOCK_SHIFT        4
+#elif (DETECT_PERIOD_MS << 3) <= (DETECT_HIT_MIN_MS / 2)
+#define GOERTZEL_BLOCK_SHIFT        3
+#elif (DETECT_PERIOD_MS << 2) <= (DETECT_HIT_MIN_MS / 2)
+#define GOERTZEL_BLOCK_SHIFT        2
+#else
+#define GOERTZEL_BLOCK_SHIFT        2
+#define GOERTZEL_BLOCK_TOO_LONG
+#endif
+#define GOERTZEL_DC_SHIFT           3
+#define GOERTZEL_MIN_LEVEL          16
+
+// Background recalibration averages 2^CALIBRATE_SAMPLES_SHIFT of the
+// detector's ambient samples, at least CALIBRATE_PERIOD_MS apart, while the
+// target keeps detecting
+#define CALIBRATE_SAMPLES_SHIFT     5
+#define CALIBRATE_PERIOD_MS         100
+// The saved calibration is only rewritten once a baseline mean has moved by
+// more than its noise estimate, and at least 1/2^CALIBRATE_SAVE_SHIFT of
+// itself, from what is in flash
+#define CALIBRATE_SAVE_SHIFT        4
+
+#endif
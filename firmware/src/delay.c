@@ -1,23 +1,52 @@
-/**
-@file delay.c
-@brief Simple delay using global timer
-@author Joe Brown
-*/
-#include "global.h"
-#include "delay.h"
-#include "schedule.h"
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-void Delay(uint32_t delay_time)
-{
-    uint32_t start_time = TimeNow();
-    uint32_t end_time = start_time + (delay_time * _MILLISECOND);
-    while(TimeNow() < end_time);
-}
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-void DumbDelay(uint32_t delay_time)
-{
-    volatile uint32_t cnt = 0;
-    while(cnt++ < delay_time);
-}
+/**
+@file delay.c
+@brief Simple delay using global timer
+@author Joe Brown
+*/
+#include "global.h"
+#include "delay.h"
+#include "schedule.h"
+
+#ifdef SCHEDULE_TICKLESS
+/** @brief set by the callout that ends a delay */
+static volatile uint8_t delay_done = FALSE;
+
+/**
+@brief Callout that ends a delay
+*/
+static void DelayDone(void);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void DelayDone(void)
+{
+    delay_done = TRUE;
+}
+#endif
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void Delay(uint32_t delay_time)
+{
+#ifdef SCHEDULE_TICKLESS
+    // Sleep through it, waking for any callbacks on the way
+    delay_done = FALSE;
+    if (CalloutRegister(DelayDone, delay_time) == SUCCESS)
+    {
+        while (!delay_done)
+        {
+            ScheduleSleep();
+        }
+        return;
+    }
+    // No callout free, spin instead
+#endif
+    uint32_t start_time = TimeNow();
+    uint32_t end_time = start_time + ScheduleMsToTicks(delay_time);
+    while(TimeNow() < end_time);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void DumbDelay(uint32_t delay_time)
+{
+    volatile uint32_t cnt = 0;
+    while(cnt++ < delay_time);
+}
@@ -0,0 +1,47 @@
+/**
+@file fixed.c
+@brief Multiply and divide free integer math helpers
+@author Joe Brown
+*/
+#include "global.h"
+#include "fixed.h"
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint32_t FixedMul(uint32_t a, uint16_t b)
+{
+    uint32_t ret = 0;
+    while (b)
+    {
+        if (b & 1)
+        {
+            ret += a;
+        }
+        a <<= 1;
+        b >>= 1;
+    }
+    return ret;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint32_t FixedDiv(uint32_t num, uint32_t den)
+{
+    uint32_t quot = 0;
+    uint32_t rem = 0;
+    uint8_t carry = 0;
+    int8_t bit = 0;
+    if (den == 0)
+    {
+        return 0xFFFFFFFF;
+    }
+    for (bit = 31;bit >= 0;bit--)
+    {
+        carry = (uint8_t)(rem >> 31);
+        rem = (rem << 1) | ((num >> bit) & 1);
+        if (carry || rem >= den)
+        {
+            rem -= den;
+            quot |= (uint32_t)1 << bit;
+        }
+    }
+    return quot;
+}
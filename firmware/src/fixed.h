@@ -0,0 +1,63 @@
+/**
+@file fixed.h
+@brief Multiply and divide free integer math helpers
+@author Joe Brown
+*/
+#ifndef FIXED_H
+#define FIXED_H
+
+// The G2452 has no hardware multiplier so any * or / on a variable pulls in the
+// compiler's software routines. Everything here is shifts, adds and compares.
+
+/**@brief n/16 of x, n must be a constant from 0 to 16 for this to fold away */
+#define FIXED_FRAC16(x,n)       ((((n) & 16) ? (x)      : 0) + \
+                                 (((n) & 8)  ? (x) >> 1 : 0) + \
+                                 (((n) & 4)  ? (x) >> 2 : 0) + \
+                                 (((n) & 2)  ? (x) >> 3 : 0) + \
+                                 (((n) & 1)  ? (x) >> 4 : 0))
+
+/**@brief Clamp a 32 bit value into 16 bits */
+#define FIXED_SAT16(x)          (((x) > 0xFFFF) ? 0xFFFF : (uint16_t)(x))
+
+/**@brief Clamp a 32 bit value into 8 bits */
+#define FIXED_SAT8(x)           (((x) > 0xFF) ? 0xFF : (uint8_t)(x))
+
+/**@brief Mean of 2^shift samples summed with FixedAccumulate */
+#define FIXED_MEAN(acc,shift)   FIXED_SAT16((acc) >> (shift))
+
+/**
+@brief Add a sample to a 32 bit sum, sticking at the top instead of wrapping
+@details
+A function rather than a macro so a sensor read passed as x happens once.
+@param[in] acc running sum
+@param[in] x sample to add
+@return acc + x, or 0xFFFFFFFF if that would wrap
+*/
+static inline uint32_t FixedAccumulate(uint32_t acc, uint32_t x)
+{
+    return ((acc > 0xFFFFFFFF - x) ? 0xFFFFFFFF : acc + x);
+}
+
+/**
+@brief Multiply by shift and add
+@details
+One shift and at most one add per bit of b. Meant for setup time conversions
+like milliseconds to scheduler ticks, not for per-sample work.
+@param[in] a multiplicand
+@param[in] b multiplier
+@return a * b, truncated to 32 bits
+*/
+extern uint32_t FixedMul(uint32_t a, uint16_t b);
+
+/**
+@brief Divide by shift and subtract
+@details
+Restoring division, one step per quotient bit. Like FixedMul this is for setup
+and once-per-hit math, never the sample path.
+@param[in] num dividend
+@param[in] den divisor, a divisor of zero returns 0xFFFFFFFF
+@return num / den
+*/
+extern uint32_t FixedDiv(uint32_t num, uint32_t den);
+
+#endif // FIXED_H
@@ -0,0 +1,64 @@
+/**
+@file flash.c
+@brief Information flash programming
+@author Joe Brown
+*/
+#include "global.h"
+#include "flash.h"
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t FlashWriteSegment(uint8_t* segment, const void* src, uint8_t len)
+{
+    const uint8_t* data = (const uint8_t*)src;
+    uint8_t i = 0;
+    uint16_t gie = __get_SR_register() & GIE;
+    if (len > FLASH_INFO_SEGMENT_SIZE)
+    {
+        return (FAILURE);
+    }
+
+    _DINT();
+    // MCLK / 2^18 lands inside the flash timing window for every calibrated
+    // DCO setting (1,8,12,16MHz)
+    FCTL2 = FWKEY + FSSEL_1 + ((g_clock_speed >> 18) - 1);
+    FCTL3 = FWKEY;                  // Unlock
+    FCTL1 = FWKEY + ERASE;
+    *segment = 0;                   // Dummy write starts the segment erase
+    FCTL1 = FWKEY + WRT;
+    for (i = 0;i < len;i++)
+    {
+        segment[i] = data[i];
+    }
+    FCTL1 = FWKEY;
+    FCTL3 = FWKEY + LOCK;
+    // Callers reached from the scheduler interrupt must not get them back
+    if (gie)
+    {
+        _EINT();
+    }
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint16_t FlashCrc16(const void* data, uint8_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint16_t crc = 0xFFFF;
+    uint8_t i = 0;
+    while (len--)
+    {
+        crc ^= (uint16_t)(*p++) << 8;
+        for (i = 0;i < 8;i++)
+        {
+            if (crc & 0x8000)
+            {
+                crc = (crc << 1) ^ 0x1021;
+            }
+            else
+            {
+                crc <<= 1;
+            }
+        }
+    }
+    return crc;
+}
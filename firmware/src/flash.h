@@ -0,0 +1,41 @@
+/**
+@file flash.h
+@brief Definitions and prototypes for writing the information flash
+@author Joe Brown
+*/
+#ifndef FLASH_H
+#define FLASH_H
+
+// Information memory segments. Segment A holds the factory DCO calibration
+// constants and is never touched here.
+#define FLASH_INFO_SEGMENT_SIZE 64
+#define FLASH_INFO_D            ((uint8_t*)0x1000)
+#define FLASH_INFO_C            ((uint8_t*)0x1040)
+#define FLASH_INFO_B            ((uint8_t*)0x1080)
+
+/**
+@brief Replace the contents of an information flash segment
+@details
+Erase the segment and program len bytes from src into it. The flash timing
+generator is run from MCLK divided down into the 257-476kHz window based on
+g_clock_speed. Interrupts are held off while the controller is unlocked, then
+left as they were on entry, and the CPU stalls for the ~15ms the erase and
+write take.
+@param[in] segment start of the segment to write, one of FLASH_INFO_B/C/D
+@param[in] src data to write
+@param[in] len number of bytes, at most FLASH_INFO_SEGMENT_SIZE
+@return SUCCESS if the data was written, FAILURE if it did not fit
+*/
+extern int8_t FlashWriteSegment(uint8_t* segment, const void* src, uint8_t len);
+
+/**
+@brief Calculate a CRC-16-CCITT over a block of memory
+@details
+Bitwise implementation with no lookup table to save flash. Starts from 0xFFFF.
+@param[in] data block to check
+@param[in] len number of bytes
+@return the CRC
+*/
+extern uint16_t FlashCrc16(const void* data, uint8_t len);
+
+#endif // FLASH_H
@@ -1,273 +1,508 @@
-/**
-@file schedule.c
-@brief Generic scheduling mechanisms
-@author Joe Brown
-*/
-#include "global.h"
-#include "schedule.h"
-#include "hardware_init.h"
-#include "config.h"
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-//                            __                        __
-//                           / /   ____   _____ ____ _ / /
-//                          / /   / __ \ / ___// __ `// /
-//                         / /___/ /_/ // /__ / /_/ // /
-//                        /_____/\____/ \___/ \__,_//_/
-//
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-#define WDT_INT_ENABLE IE1
-#define SCHEDULE_VECTOR WDT_VECTOR
-
-// global time
-uint32_t now = 0;
-
-// multiplier for timing
-volatile uint8_t g_timing_multiplier = 0;
-
-/** @brief number of registered callouts*/
-static uint8_t event_count;
-/** @brief configured callback list*/
-static CallbackEvent callback_store[MAX_CALLBACK_CNT];
-
-/** @brief bit array represending occupied or vacant callouts*/
-static uint16_t callout_map;
-
-/** @brief Congiruation for callout which holds the function pointer and next
-time it will run.*/
-typedef struct
-{
-    CalloutFn func;
-    uint32_t run_time;
-} CalloutEvent;
-
-/** @brief Array of function callouts. If a callout is enabled it will have a
-function pointer stored and if it is disabled the pointer will be replaced
-with a null*/
-static CalloutEvent callout_store[MAX_CALLOUT_CNT];
-
-/**
-@brief Check the callback list for functions that are ready to run
-@details
-Search the callback store for functions that enabled with a time that is equal
-to the current global time. If we find the function call it and reset the
-run_time based on the stored value.
-@param[in] current_time current global time from now variable
-*/
-static void CallbackService(uint32_t current_time);
-
-/**
-@brief Check the callout list for functions that are ready to run
-@details
-Search the callout store for functions that enabled with a time that is equal
-to the current global time. If we find the function call it and vacate the slot
-in the map.
-@param[in] current_time current global time from now variable
-*/
-static void CalloutService(uint32_t current_time);
-
-/**
-@brief Return the number of occupied slots in the callout map (pending callouts)
-@details
-Use K&R method to run through the callout map and count the number of bits. This
-represents the number of slot occupied in the callout store.
-@return the number of functions pending in the callout map
-*/
-static uint8_t get_callout_map_size(void);
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-//                            ____        _  __
-//                           /  _/____   (_)/ /_
-//                           / / / __ \ / // __/
-//                         _/ / / / / // // /_
-//                        /___//_/ /_//_/ \__/
-//
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-void ScheduleTimerInit(void)
-{
-    // divide the mclk by 512
-    WDTCTL = WDT_MDLY_0_5;
-    // calculate the multiplier (number of clks to get to 1ms)
-    g_timing_multiplier = (g_clock_speed / 1000000) * 2;
-    WDT_INT_ENABLE |= WDTIE;    // Enable WDT interrupt
-}
-
-uint32_t TimeNow(void)
-{
-    return now;
-}
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-//            ____        __                                   __
-//           /  _/____   / /_ ___   _____ _____ __  __ ____   / /_
-//           / / / __ \ / __// _ \ / ___// ___// / / // __ \ / __/
-//         _/ / / / / // /_ /  __// /   / /   / /_/ // /_/ // /_
-//        /___//_/ /_/ \__/ \___//_/   /_/    \__,_// .___/ \__/
-//                                                 /_/
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-#pragma vector=SCHEDULE_VECTOR
-__interrupt void ScheduleTimerOverflow(void)
-{
-    now++;
-    CallbackService(now);
-    CalloutService(now);
-}
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-//               ______        __ __ __                  __
-//              / ____/____ _ / // // /_   ____ _ _____ / /__
-//             / /    / __ `// // // __ \ / __ `// ___// //_/
-//            / /___ / /_/ // // // /_/ // /_/ // /__ / ,<
-//            \____/ \__,_//_//_//_.___/ \__,_/ \___//_/|_|
-//
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-int8_t CallbackRegister(CallbackFn func, uint32_t run_time)
-{
-    if (event_count < sizeof(callback_store)/sizeof(CallbackFn))
-    {
-        // Callbacks are initialized disabled
-        callback_store[event_count].enabled       = FALSE;
-        callback_store[event_count].func          = func;
-        callback_store[event_count].run_time      = run_time - 1;
-        callback_store[event_count].next_run_time = now + (run_time * _MILLISECOND);
-        event_count++;
-        return (SUCCESS);
-    }
-    return (FAILURE);
-}
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-void CallbackService(uint32_t current_time)
-{
-    uint8_t i = 0;
-    uint8_t callbacks_remaining = event_count;
-    if (callbacks_remaining == 0)
-    {
-        goto service_complete;
-    }
-    for (i = 0;i < event_count;i++)
-    {
-        if (callback_store[i].enabled == TRUE &&
-            current_time == callback_store[i].next_run_time)
-        {
-            callback_store[i].next_run_time = current_time +
-                                              (callback_store[i].run_time * _MILLISECOND);
-            callback_store[i].func();
-            if (--callbacks_remaining == 0)
-            {
-                goto service_complete;
-            }
-        }
-    }
-service_complete:
-    return;
-}
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-void CallbackMode(CallbackFn func, enum ScheduleMode mode)
-{
-    uint8_t i = 0;
-    for (i = 0;i < event_count;i++)
-    {
-        if (func == callback_store[i].func)
-        {
-            callback_store[i].enabled = mode;
-            if (mode)
-            {
-                callback_store[i].next_run_time = now +
-                                                  (callback_store[i].run_time * _MILLISECOND);
-            }
-            break;
-        }
-    }
-}
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-//                   ______        __ __               __
-//                  / ____/____ _ / // /____   __  __ / /_
-//                 / /    / __ `// // // __ \ / / / // __/
-//                / /___ / /_/ // // // /_/ // /_/ // /_
-//                \____/ \__,_//_//_/ \____/ \__,_/ \__/
-//
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-int8_t CalloutRegister(CalloutFn func, uint32_t run_time)
-{
-    // event queue full?
-    if (get_callout_map_size() != MAX_CALLOUT_CNT)
-    {
-        uint8_t i = 0;
-        for (i = 0;i < MAX_CALLOUT_CNT;i++)
-        {
-            // find the first open slot
-            if (!(callout_map & _BV(i)))
-            {
-                // claim the slot
-                callout_map |= _BV(i);
-                // save our data
-                callout_store[i].func = func;
-                callout_store[i].run_time = now + (run_time * _MILLISECOND);
-                return (SUCCESS);
-            }
-        }
-    }
-    return (FAILURE);
-}
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-void CalloutCancel(CalloutFn func)
-{
-    uint8_t i = 0;
-    for (i = 0;i < MAX_CALLOUT_CNT;i++)
-    {
-        // find the slot
-        if (callout_store[i].func == func)
-        {
-            // clear
-            callout_map &= ~_BV(i);
-            break;
-        }
-    }
-}
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-uint8_t get_callout_map_size(void)
-{
-    uint8_t sum = 0;
-    uint16_t map = callout_map;
-    for (sum = 0; map; sum++)
-    {
-        map &= map - 1;
-    }
-    return sum;
-}
-
-//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-void CalloutService(uint32_t current_time)
-{
-    uint8_t i = 0;
-    // get the number of callouts
-    uint8_t callouts_remaining = get_callout_map_size();
-    // if there are none to service
-    if (!callouts_remaining)
-    {
-        goto service_complete;
-    }
-    for (i = 0;i < MAX_CALLOUT_CNT;i++)
-    {
-        // find occupied slots and see if the function there is ready
-        if ((callout_map & _BV(i)) && current_time == callout_store[i].run_time)
-        {
-            // run the function
-            callout_store[i].func();
-            // vacate the slot
-            callout_map &= ~_BV(i);
-            // decrement the number left and see if we can stop
-            if (--callouts_remaining == 0)
-            {
-                goto service_complete;
-            }
-        }
-    }
-service_complete:
-    return;
-}
+/**
+@file schedule.c
+@brief Generic scheduling mechanisms
+@author Joe Brown
+*/
+#include "global.h"
+#include "schedule.h"
+#include "hardware_init.h"
+#include "config.h"
+#include "fixed.h"
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                            __                        __
+//                           / /   ____   _____ ____ _ / /
+//                          / /   / __ \ / ___// __ `// /
+//                         / /___/ /_/ // /__ / /_/ // /
+//                        /_____/\____/ \___/ \__,_//_/
+//
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+#define SCHEDULE_VECTOR TIMER0_A0_VECTOR
+#ifdef SCHEDULE_TICKLESS
+#define SCHEDULE_WRAP_VECTOR TIMER0_A1_VECTOR
+// TAIV value for a timer overflow
+#define SCHEDULE_TAIV_WRAP 10
+// closest a compare is set ahead of TAR, TAR is read through a clock it is not
+// synchronous to and a compare already passed would not match for 2^16 ticks
+#define SCHEDULE_MIN_AHEAD 2
+// The interrupt can come late, anything at or past its time is due
+#define SCHEDULE_DUE(t, when) ((int32_t)((t) - (when)) >= 0)
+
+// high half of the global time, the low half is TAR
+static volatile uint16_t now_high = 0;
+// time the compare was set for
+static uint32_t wake_time = 0;
+// set when the interrupt ran something, cleared by ScheduleSleep
+static volatile uint8_t woken = FALSE;
+#ifdef SCHEDULE_ACLK_VLO
+// VLO cycles timed against SMCLK at boot, SMCLK over this many cycles is
+// the VLO rate over the same number
+#define SCHEDULE_VLO_CYCLES 8
+// VLO rate over 8, nominal until ScheduleTimerInit measures it
+static uint16_t vlo_hz_8 = SCHEDULE_ACLK_HZ / 8;
+#endif
+#else
+// ticks in a second, the timer counts SMCLK up to g_clock_speed over this
+#define SCHEDULE_TICK_HZ (1000000UL / SCHEDULE_TICK_US)
+// Every tick is serviced, so a time is only due on its own tick
+#define SCHEDULE_DUE(t, when) ((t) == (when))
+
+// global time
+uint32_t now = 0;
+#endif
+
+/** @brief number of registered callouts*/
+static uint8_t event_count;
+/** @brief configured callback list*/
+static CallbackEvent callback_store[MAX_CALLBACK_CNT];
+
+/** @brief bit array represending occupied or vacant callouts*/
+static uint16_t callout_map;
+
+/** @brief Congiruation for callout which holds the function pointer and next
+time it will run.*/
+typedef struct
+{
+    CalloutFn func;
+    uint32_t run_time;
+} CalloutEvent;
+
+/** @brief Array of function callouts. If a callout is enabled it will have a
+function pointer stored and if it is disabled the pointer will be replaced
+with a null*/
+static CalloutEvent callout_store[MAX_CALLOUT_CNT];
+
+/**
+@brief Check the callback list for functions that are ready to run
+@details
+Search the callback store for functions that enabled with a time that is equal
+to the current global time. If we find the function call it and reset the
+run_time based on the stored value.
+@param[in] current_time current global time from now variable
+*/
+static void CallbackService(uint32_t current_time);
+
+/**
+@brief Check the callout list for functions that are ready to run
+@details
+Search the callout store for functions that enabled with a time that is equal
+to the current global time. If we find the function call it and vacate the slot
+in the map.
+@param[in] current_time current global time from now variable
+*/
+static void CalloutService(uint32_t current_time);
+
+/**
+@brief Return the number of occupied slots in the callout map (pending callouts)
+@details
+Use K&R method to run through the callout map and count the number of bits. This
+represents the number of slot occupied in the callout store.
+@return the number of functions pending in the callout map
+*/
+static uint8_t get_callout_map_size(void);
+
+#ifdef SCHEDULE_TICKLESS
+/**
+@brief Set the compare for the earliest enabled callback or pending callout
+@details
+Turns the compare interrupt off when nothing is waiting, the overflow keeps
+the time. Call whenever a callback or callout is enabled or goes away.
+*/
+static void ScheduleNext(void);
+
+/**
+@brief Read TAR, which counts ACLK asynchronously to the CPU
+@return the timer count, read twice the same in a row
+*/
+static uint16_t TimerRead(void);
+#endif
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                            ____        _  __
+//                           /  _/____   (_)/ /_
+//                           / / / __ \ / // __/
+//                         _/ / / / / // // /_
+//                        /___//_/ /_//_/ \__/
+//
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void ScheduleTimerInit(void)
+{
+#ifdef SCHEDULE_TICKLESS
+#ifdef SCHEDULE_ACLK_VLO
+    uint16_t start = 0;
+    uint16_t cycles = 0;
+    uint8_t  i = 0;
+    BCSCTL3 = LFXT1S_2;                 // ACLK from the VLO
+    // The VLO is anywhere from 4 to 20kHz, the calibrated DCO is good to a
+    // few percent, so count SMCLK and capture it on rising ACLK edges
+    TACTL   = TASSEL_2 + ID_0 + TACLR + MC_2;
+    TACCTL0 = CM_1 + CCIS_1 + CAP;      // CCI0B is ACLK
+    while (!(TACCTL0 & CCIFG));
+    start = TACCR0;
+    for (i = 0; i < SCHEDULE_VLO_CYCLES; i++)
+    {
+        TACCTL0 &= ~CCIFG;
+        while (!(TACCTL0 & CCIFG));
+    }
+    // At most 16MHz over 4kHz times 8, so it fits the timer
+    cycles = TACCR0 - start;
+    vlo_hz_8 = FixedDiv(g_clock_speed + (cycles >> 1), cycles);
+#else
+    BCSCTL3 = XCAP_3;                   // 32768Hz crystal, 12.5pF load
+    while (BCSCTL3 & LFXT1OF);          // wait for it to start
+#endif
+    TACTL   = TASSEL_1 + ID_0 + TACLR;  // stop and clear, ACLK undivided
+    TACCTL0 = 0;                        // nothing due yet
+    now_high = 0;
+    TACTL  |= MC_2 + TAIE;              // count continuously, count the wraps
+#else
+    // SMCLK clocks in a tick, at most 16000 so it always fits the timer
+    uint16_t period = FixedDiv(g_clock_speed, SCHEDULE_TICK_HZ);
+    TACTL   = TASSEL_2 + ID_0 + TACLR;  // stop and clear, SMCLK undivided
+    TACCR0  = period - 1;               // up mode counts 0 to TACCR0
+    TACCTL0 = CCIE;                     // interrupt on reaching TACCR0
+    TACTL  |= MC_1;                     // start counting up
+#endif
+}
+
+uint32_t ScheduleMsToTicks(uint32_t ms)
+{
+#ifdef SCHEDULE_TICKLESS
+#ifdef SCHEDULE_ACLK_VLO
+    return FixedDiv(FixedMul(ms, vlo_hz_8), 125);
+#elif SCHEDULE_ACLK_HZ % 1000 == 0
+    return FixedMul(ms, SCHEDULE_ACLK_HZ / 1000);
+#else
+    return FixedDiv(FixedMul(ms, SCHEDULE_ACLK_HZ / 8), 125);
+#endif
+#elif SCHEDULE_TICK_US == 1000
+    return ms;
+#else
+    return FixedMul(ms, _MILLISECOND);
+#endif
+}
+
+#ifdef SCHEDULE_TICKLESS
+uint32_t TimeNow(void)
+{
+    uint16_t gie = __get_SR_register() & GIE;
+    uint16_t high = 0;
+    uint16_t low = 0;
+    _DINT();
+    low  = TimerRead();
+    high = now_high;
+    // A wrap not counted yet belongs to a low TAR, a high one was read
+    // before it
+    if ((TACTL & TAIFG) && low < 0x8000)
+    {
+        high++;
+    }
+    if (gie)
+    {
+        _EINT();
+    }
+    return (((uint32_t)high << 16) | low);
+}
+
+uint16_t TimerRead(void)
+{
+    uint16_t a = 0;
+    uint16_t b = 0;
+    do
+    {
+        a = TAR;
+        b = TAR;
+    } while (a != b);
+    return (a);
+}
+
+void ScheduleSleep(void)
+{
+    _DINT();
+    if (!woken)
+    {
+        // GIE is set by the same instruction that sleeps, so an interrupt
+        // cannot slip in between checking and sleeping
+        __bis_SR_register(LPM3_bits + GIE);
+        _DINT();
+    }
+    woken = FALSE;
+    _EINT();
+}
+#else
+uint32_t TimeNow(void)
+{
+    return now;
+}
+#endif
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//            ____        __                                   __
+//           /  _/____   / /_ ___   _____ _____ __  __ ____   / /_
+//           / / / __ \ / __// _ \ / ___// ___// / / // __ \ / __/
+//         _/ / / / / // /_ /  __// /   / /   / /_/ // /_/ // /_
+//        /___//_/ /_/ \__/ \___//_/   /_/    \__,_// .___/ \__/
+//                                                 /_/
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+#pragma vector=SCHEDULE_VECTOR
+__interrupt void ScheduleTimerOverflow(void)
+{
+#ifdef SCHEDULE_TICKLESS
+    uint32_t current_time = TimeNow();
+    // The compare only holds the low half, it also matches once per wrap
+    // before a far away wake time
+    if (!SCHEDULE_DUE(current_time, wake_time))
+    {
+        return;
+    }
+    CallbackService(current_time);
+    CalloutService(current_time);
+    ScheduleNext();
+    woken = TRUE;
+    __bic_SR_register_on_exit(LPM3_bits);
+#else
+    now++;
+    CallbackService(now);
+    CalloutService(now);
+#endif
+}
+
+#ifdef SCHEDULE_TICKLESS
+#pragma vector=SCHEDULE_WRAP_VECTOR
+__interrupt void ScheduleTimerWrap(void)
+{
+    // Reading TAIV clears the flag, only the overflow is enabled
+    if (TAIV == SCHEDULE_TAIV_WRAP)
+    {
+        now_high++;
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void ScheduleNext(void)
+{
+    uint16_t gie = __get_SR_register() & GIE;
+    uint32_t current_time = 0;
+    uint8_t i = 0;
+    uint8_t pending = FALSE;
+    int32_t ahead = 0;
+    int32_t soonest = 0;
+    _DINT();
+    // Plan from now, the call*s that just ran took time
+    current_time = TimeNow();
+    for (i = 0;i < event_count;i++)
+    {
+        if (callback_store[i].enabled == TRUE)
+        {
+            ahead = (int32_t)(callback_store[i].next_run_time - current_time);
+            if (!pending || ahead < soonest)
+            {
+                soonest = ahead;
+                pending = TRUE;
+            }
+        }
+    }
+    for (i = 0;i < MAX_CALLOUT_CNT;i++)
+    {
+        if (callout_map & _BV(i))
+        {
+            ahead = (int32_t)(callout_store[i].run_time - current_time);
+            if (!pending || ahead < soonest)
+            {
+                soonest = ahead;
+                pending = TRUE;
+            }
+        }
+    }
+    if (pending)
+    {
+        // Anything already due runs as soon as the compare can catch it
+        if (soonest < SCHEDULE_MIN_AHEAD)
+        {
+            soonest = SCHEDULE_MIN_AHEAD;
+        }
+        wake_time = current_time + soonest;
+        TACCR0  = (uint16_t)wake_time;
+        TACCTL0 = CCIE;                 // also clears a stale CCIFG
+    }
+    else
+    {
+        TACCTL0 = 0;
+    }
+    if (gie)
+    {
+        _EINT();
+    }
+}
+#endif
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//               ______        __ __ __                  __
+//              / ____/____ _ / // // /_   ____ _ _____ / /__
+//             / /    / __ `// // // __ \ / __ `// ___// //_/
+//            / /___ / /_/ // // // /_/ // /_/ // /__ / ,<
+//            \____/ \__,_//_//_//_.___/ \__,_/ \___//_/|_|
+//
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t CallbackRegister(CallbackFn func, uint32_t run_time)
+{
+    if (event_count < sizeof(callback_store)/sizeof(CallbackFn))
+    {
+        // Callbacks are initialized disabled
+        callback_store[event_count].enabled       = FALSE;
+        callback_store[event_count].func          = func;
+        // keep the period in ticks so the interrupt never has to multiply
+        callback_store[event_count].run_time      = ScheduleMsToTicks(run_time);
+        callback_store[event_count].next_run_time = TimeNow() +
+                                                    callback_store[event_count].run_time;
+        event_count++;
+        return (SUCCESS);
+    }
+    return (FAILURE);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CallbackService(uint32_t current_time)
+{
+    uint8_t i = 0;
+    uint8_t callbacks_remaining = event_count;
+    if (callbacks_remaining == 0)
+    {
+        goto service_complete;
+    }
+    for (i = 0;i < event_count;i++)
+    {
+        if (callback_store[i].enabled == TRUE &&
+            SCHEDULE_DUE(current_time, callback_store[i].next_run_time))
+        {
+            // from when it was due so a late interrupt does not drift it
+            callback_store[i].next_run_time += callback_store[i].run_time;
+            callback_store[i].func();
+            if (--callbacks_remaining == 0)
+            {
+                goto service_complete;
+            }
+        }
+    }
+service_complete:
+    return;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CallbackMode(CallbackFn func, enum ScheduleMode mode)
+{
+    uint8_t i = 0;
+    for (i = 0;i < event_count;i++)
+    {
+        if (func == callback_store[i].func)
+        {
+            callback_store[i].enabled = mode;
+            if (mode)
+            {
+                callback_store[i].next_run_time = TimeNow() +
+                                                  callback_store[i].run_time;
+            }
+#ifdef SCHEDULE_TICKLESS
+            ScheduleNext();
+#endif
+            break;
+        }
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                   ______        __ __               __
+//                  / ____/____ _ / // /____   __  __ / /_
+//                 / /    / __ `// // // __ \ / / / // __/
+//                / /___ / /_/ // // // /_/ // /_/ // /_
+//                \____/ \__,_//_//_/ \____/ \__,_/ \__/
+//
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t CalloutRegister(CalloutFn func, uint32_t run_time)
+{
+    // event queue full?
+    if (get_callout_map_size() != MAX_CALLOUT_CNT)
+    {
+        uint8_t i = 0;
+        for (i = 0;i < MAX_CALLOUT_CNT;i++)
+        {
+            // find the first open slot
+            if (!(callout_map & _BV(i)))
+            {
+                // claim the slot
+                callout_map |= _BV(i);
+                // save our data
+                callout_store[i].func = func;
+                callout_store[i].run_time = TimeNow() + ScheduleMsToTicks(run_time);
+#ifdef SCHEDULE_TICKLESS
+                ScheduleNext();
+#endif
+                return (SUCCESS);
+            }
+        }
+    }
+    return (FAILURE);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CalloutCancel(CalloutFn func)
+{
+    uint8_t i = 0;
+    for (i = 0;i < MAX_CALLOUT_CNT;i++)
+    {
+        // find the slot
+        if (callout_store[i].func == func)
+        {
+            // clear
+            callout_map &= ~_BV(i);
+#ifdef SCHEDULE_TICKLESS
+            ScheduleNext();
+#endif
+            break;
+        }
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint8_t get_callout_map_size(void)
+{
+    uint8_t sum = 0;
+    uint16_t map = callout_map;
+    for (sum = 0; map; sum++)
+    {
+        map &= map - 1;
+    }
+    return sum;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CalloutService(uint32_t current_time)
+{
+    uint8_t i = 0;
+    // get the number of callouts
+    uint8_t callouts_remaining = get_callout_map_size();
+    // if there are none to service
+    if (!callouts_remaining)
+    {
+        goto service_complete;
+    }
+    for (i = 0;i < MAX_CALLOUT_CNT;i++)
+    {
+        // find occupied slots and see if the function there is ready
+        if ((callout_map & _BV(i)) &&
+            SCHEDULE_DUE(current_time, callout_store[i].run_time))
+        {
+            // run the function
+            callout_store[i].func();
+            // vacate the slot
+            callout_map &= ~_BV(i);
+            // decrement the number left and see if we can stop
+            if (--callouts_remaining == 0)
+            {
+                goto service_complete;
+            }
+        }
+    }
+service_complete:
+    return;
+}
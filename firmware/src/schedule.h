@@ -1,111 +1,180 @@
-/**
-@file schedule.h
-@brief Definitions, data structues and prototypes for generic scheduling mechanisms
-@author Joe Brown
-*/
-#ifndef SCHEDULE_H
-#define SCHEDULE_H
-
-
-/** @brief timing multiplier to allow regular interval scheduling with varying
-clock speeds */
-extern volatile uint8_t g_timing_multiplier;
-
-// Timing divisors for scheduling
-// The base time millisecond will always be 1.024ms due to the watchdog timer
-// divisors. For that reason we will multiply _SECOND by slightly less than 1000
-// to account for it and make subsequent multipliers slightly more accurate
-#define _MILLISECOND        g_timing_multiplier
-
-/** @brief function pointer to a callback*/
-typedef void (*CallbackFn)(void);
-/** @brief function pointer to a callout*/
-typedef void (*CalloutFn)(void);
-
-/** @brief Configuration for callback which holds the function pointer,
-run time (period), next time it will run, and whether or not it is enabled*/
-typedef struct
-{
-    CallbackFn func;
-    uint8_t    enabled;
-    uint32_t   run_time;
-    uint32_t   next_run_time;
-} CallbackEvent;
-
-enum ScheduleMode
-{
-    ENABLED  = 1,
-    DISABLED = 0
-};
-
-/**
-@brief Initialize the schedule timer used to check callouts and callbacks
-@details
-Configure the watchdog timer to periodically wake up and service the scheduler
-tasks. We currently use a 0.5 ms period and save the multiplier to
-g_timing_multiplier. This is used in the definition of _MILLISECOND to give
-flexible timing.
-*/
-extern void ScheduleTimerInit(void);
-
-/**
-@brief Interrupt routine run by overflow of watchdog timer
-@details
-When the interrupt fires increment the global time and service the call*s.
-*/
-extern __interrupt void ScheduleTimerOverflow(void);
-
-/**
-@brief Get the current tick time
-@details
-Every tick of the time a variable is incremented. This function gets the
-current ticks for use in timing.
-@return current tick time
-*/
-extern uint32_t TimeNow(void);
-
-/**
-@brief Add a callback to the store for periodic execution
-@details
-Take the function and run time and store them in the callback store. Intially
-set the enabled flag to false to keep us from accidentally calling a function
-before it is expected.
-@param[in] func function pointer registered to callback
-@param[in] run_time period on which to run the callback function
-@return SUCCESS if callback registered successfully, FAILURE otherwise
-*/
-extern int8_t CallbackRegister(CallbackFn func, uint32_t run_time);
-
-/**
-@brief Enable or disable a function callback
-@details
-Search the callback store for the specified function and enable or disable it
-based on the mode passed in.
-@param[in] func callback function to configure
-@param[in] mode enabled or disabled
-*/
-extern void CallbackMode(CallbackFn func, enum ScheduleMode mode);
-
-/**
-@brief Add a callout to the store for one-time execution
-@details
-Take the function and run time and store them in the callout store. For callouts
-we maintain a "map" of callouts in a bit array. When we store a new function we
-find an empty slot (0 in the bit array) and set it. That bit corresponds to the
-index of the callout store the function pointer is stored at.
-@param[in] func function pointer registered to callout slot
-@param[in] run_time Specific time in which to run the function
-@return SUCCESS if callback registered successfully, FAILURE otherwise
-*/
-extern int8_t CalloutRegister(CalloutFn func, uint32_t run_time);
-
-/**
-@brief Disable a function callout before it has run
-@details
-Search the callout store for the specific function. If we find it go clear the
-map to indicate the slot is vacant.
-@param[in] func function pointer to search for and cancel
-*/
-extern void CalloutCancel(CalloutFn func);
-
-#endif // SCHEDULE_H
+/**
+@file schedule.h
+@brief Definitions, data structues and prototypes for generic scheduling mechanisms
+@author Joe Brown
+*/
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+
+#ifdef SCHEDULE_TICKLESS
+#if SCHEDULE_ACLK_HZ % 8
+#error "SCHEDULE_ACLK_HZ must be a multiple of 8"
+#endif
+
+// Timing divisors for scheduling
+// A tick is one ACLK cycle, which is not always a whole number of
+// milliseconds, so there is no _MILLISECOND. With the crystal this is a 32
+// bit multiply and divide, only give it constants so the compiler works it
+// out, and use ScheduleMsToTicks for anything else. ms up to about 17 minutes.
+// The VLO rate is only known once ScheduleTimerInit has measured it, so there
+// it is a call to ScheduleMsToTicks, keep it out of anything run per sample.
+#ifdef SCHEDULE_ACLK_VLO
+#define SCHEDULE_TICKS(ms)  ScheduleMsToTicks(ms)
+#else
+#define SCHEDULE_TICKS(ms)  ((uint32_t)(ms) * (SCHEDULE_ACLK_HZ / 8) / 125)
+#endif
+#else
+#if (SCHEDULE_TICK_US == 0) || (1000 % SCHEDULE_TICK_US)
+#error "SCHEDULE_TICK_US must divide a millisecond"
+#endif
+
+// Timing divisors for scheduling
+// TimerA is set up so a tick is exactly SCHEDULE_TICK_US, so the number of
+// ticks in a millisecond is known when compiling and converting a time never
+// needs a multiply at run time
+#define _MILLISECOND        (1000 / SCHEDULE_TICK_US)
+
+/** @brief Convert a constant number of milliseconds to scheduler ticks, see
+ScheduleMsToTicks for variables */
+#define SCHEDULE_TICKS(ms)  ((uint32_t)(ms) * _MILLISECOND)
+#endif // SCHEDULE_TICKLESS
+
+/** @brief function pointer to a callback*/
+typedef void (*CallbackFn)(void);
+/** @brief function pointer to a callout*/
+typedef void (*CalloutFn)(void);
+
+/** @brief Configuration for callback which holds the function pointer,
+run time (period in ticks), next time it will run, and whether or not it is
+enabled*/
+typedef struct
+{
+    CallbackFn func;
+    uint8_t    enabled;
+    uint32_t   run_time;
+    uint32_t   next_run_time;
+} CallbackEvent;
+
+enum ScheduleMode
+{
+    ENABLED  = 1,
+    DISABLED = 0
+};
+
+/**
+@brief Initialize the schedule timer used to check callouts and callbacks
+@details
+Run TimerA in up mode from SMCLK so it interrupts every SCHEDULE_TICK_US and
+services the scheduler tasks. The compare value comes from g_clock_speed, so
+call this again after changing the clock (see
+ADJUST_SCHEDULER_ON_CLOCK_CONFIG). The watchdog is left as it was.
+
+With SCHEDULE_TICKLESS TimerA counts ACLK continuously instead and only
+interrupts on overflow and when the next callback or callout is due. This
+waits for the crystal to start when SCHEDULE_ACLK_CRYSTAL is defined, so it
+hangs if none is fitted. With the VLO it first times 8 VLO cycles in SMCLK
+to find its real rate, so call it after ClockConfig and before anything
+converts a time. ACLK does not follow the DCO so there is no need to call it
+again after changing the clock.
+*/
+extern void ScheduleTimerInit(void);
+
+/**
+@brief Interrupt routine run when TimerA reaches its compare value
+@details
+When the interrupt fires increment the global time and service the call*s.
+With SCHEDULE_TICKLESS the compare is set to the next time something is due,
+so service the call*s, set up the next compare and wake the main loop.
+*/
+extern __interrupt void ScheduleTimerOverflow(void);
+
+#ifdef SCHEDULE_TICKLESS
+/**
+@brief Interrupt routine run when TimerA wraps
+@details
+Counts the high half of the time for TimeNow.
+*/
+extern __interrupt void ScheduleTimerWrap(void);
+#endif
+
+/**
+@brief Convert milliseconds that are not a constant to scheduler ticks
+@details
+SCHEDULE_TICKS done with FixedMul and FixedDiv, since the target has no
+hardware multiplier and the compiler would otherwise call its own 32 bit
+routines. Nothing at all with 1ms ticks. With the VLO it uses the rate
+ScheduleTimerInit measured. For registering and Delay, not for anything that
+runs per sample.
+@param[in] ms time in milliseconds
+@return the same time in ticks
+*/
+extern uint32_t ScheduleMsToTicks(uint32_t ms);
+
+/**
+@brief Get the current tick time
+@details
+Every tick of the time a variable is incremented. This function gets the
+current ticks for use in timing. With SCHEDULE_TICKLESS nothing runs every
+tick, the time is put together from the overflow count and TAR.
+@return current tick time
+*/
+extern uint32_t TimeNow(void);
+
+#ifdef SCHEDULE_TICKLESS
+/**
+@brief Sleep in LPM3 until the scheduler has run something
+@details
+Returns at once if a callback or callout ran since the last call, so an event
+they published is not slept through. Only the scheduler interrupt wakes the
+CPU, anything else that should wake the main loop has to clear LPM3_bits on
+exit itself. Leaves interrupts enabled. Call from the main loop only.
+*/
+extern void ScheduleSleep(void);
+#endif
+
+/**
+@brief Add a callback to the store for periodic execution
+@details
+Take the function and run time and store them in the callback store. Intially
+set the enabled flag to false to keep us from accidentally calling a function
+before it is expected.
+@param[in] func function pointer registered to callback
+@param[in] run_time period on which to run the callback function in ms
+@return SUCCESS if callback registered successfully, FAILURE otherwise
+*/
+extern int8_t CallbackRegister(CallbackFn func, uint32_t run_time);
+
+/**
+@brief Enable or disable a function callback
+@details
+Search the callback store for the specified function and enable or disable it
+based on the mode passed in.
+@param[in] func callback function to configure
+@param[in] mode enabled or disabled
+*/
+extern void CallbackMode(CallbackFn func, enum ScheduleMode mode);
+
+/**
+@brief Add a callout to the store for one-time execution
+@details
+Take the function and run time and store them in the callout store. For callouts
+we maintain a "map" of callouts in a bit array. When we store a new function we
+find an empty slot (0 in the bit array) and set it. That bit corresponds to the
+index of the callout store the function pointer is stored at.
+@param[in] func function pointer registered to callout slot
+@param[in] run_time time from now in which to run the function in ms
+@return SUCCESS if callback registered successfully, FAILURE otherwise
+*/
+extern int8_t CalloutRegister(CalloutFn func, uint32_t run_time);
+
+/**
+@brief Disable a function callout before it has run
+@details
+Search the callout store for the specific function. If we find it go clear the
+map to indicate the slot is vacant.
+@param[in] func function pointer to search for and cancel
+*/
+extern void CalloutCancel(CalloutFn func);
+
+#endif // SCHEDULE_H
@@ -1,26 +1,33 @@
-#ifndef TCS3414_color_sensor_H
-#define TCS3414_color_sensor_H
-
-enum Color
-{
-    COLOR_RED,
-    COLOR_GREEN,
-    COLOR_BLUE,
-    COLOR_CLEAR
-};
-
-typedef struct
-{
-    uint16_t red;
-    uint16_t green;
-    uint16_t blue;
-    uint16_t clear;
-} ColorReading;
-
-void Tcs3414Init(void);
-void Tcs3414Shutdown(void);
-ColorReading Tcs3414ReadAllColors(void);
-uint16_t Tcs3414ReadColor(enum Color c);
-
-
-#endif
+#ifndef TCS3414_color_sensor_H
+#define TCS3414_color_sensor_H
+
+enum Color
+{
+    COLOR_RED,
+    COLOR_GREEN,
+    COLOR_BLUE,
+    COLOR_CLEAR
+};
+
+typedef struct
+{
+    uint16_t red;
+    uint16_t green;
+    uint16_t blue;
+    uint16_t clear;
+} ColorReading;
+
+// Init and Shutdown cover every sensor and leave the first one selected,
+// reads go to the one selected last
+void Tcs3414Select(uint8_t sensor);
+void Tcs3414Init(void);
+void Tcs3414Shutdown(void);
+// TRUE once every sensor has set ADC valid since Tcs3414Init, reads before
+// then are not a finished conversion. Stops touching the bus once it is TRUE.
+uint8_t Tcs3414Ready(void);
+uint8_t Tcs3414Settings(void);
+ColorReading Tcs3414ReadAllColors(void);
+uint16_t Tcs3414ReadColor(enum Color c);
+
+
+#endif
@@ -0,0 +1,90 @@
+/**
+@file stats.c
+@brief Hit detection statistics
+@author Joe Brown
+*/
+#include "global.h"
+#include "stats.h"
+#include "schedule.h"
+#include "flash.h"
+
+#ifdef DETECT_STATS
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Locals
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+static DetectStats stats;
+
+/** @brief histogram bin width in scheduler ticks */
+static uint32_t bin_width = 0;
+
+/** @brief set when a candidate has been counted since the last dump */
+static uint8_t  dirty = FALSE;
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                Statistics
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void StatsInit(void)
+{
+    memset(&stats, 0, sizeof(stats));
+    bin_width = SCHEDULE_TICKS(STATS_BIN_MS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void StatsCandidate(uint32_t first, uint32_t last, uint32_t end, enum CandidateResult result)
+{
+    uint32_t length = end - first;
+    uint32_t release = end - last;
+    uint8_t bin = 0;
+
+    dirty = TRUE;
+    switch (result)
+    {
+        case CANDIDATE_ACCEPTED:
+        {
+            stats.accepted++;
+            break;
+        }
+        case CANDIDATE_SHORT:
+        {
+            stats.rejected_short++;
+            break;
+        }
+        case CANDIDATE_LONG:
+        {
+            stats.rejected_long++;
+            break;
+        }
+        case CANDIDATE_FLASH:
+        {
+            stats.rejected_flash++;
+            break;
+        }
+    }
+
+    if (release > stats.release_max)
+    {
+        stats.release_max = (release > 0xFFFF) ? 0xFFFF : release;
+    }
+
+    // The last bin collects everything longer than the histogram
+    while (bin < STATS_BINS - 1 && length >= bin_width)
+    {
+        length -= bin_width;
+        bin++;
+    }
+    if (stats.hist[bin] != 0xFFFF)
+    {
+        stats.hist[bin]++;
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void StatsDump(void)
+{
+    if (dirty)
+    {
+        dirty = FALSE;
+        FlashWriteSegment(FLASH_INFO_C, &stats, sizeof(stats));
+    }
+}
+#endif // DETECT_STATS
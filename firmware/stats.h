@@ -0,0 +1,64 @@
+/**
+@file stats.h
+@brief Definitions for hit detection statistics
+@author Joe Brown
+*/
+#ifndef STATS_H
+#define STATS_H
+
+/** @brief How a hit candidate ended */
+enum CandidateResult
+{
+    CANDIDATE_ACCEPTED,
+    CANDIDATE_SHORT,
+    CANDIDATE_LONG,
+    CANDIDATE_FLASH
+};
+
+/** @brief Counters and histogram of hit candidates since boot. All times are
+in scheduler ticks.*/
+typedef struct
+{
+    uint16_t accepted;              /**< candidates published as STUN */
+    uint16_t rejected_short;        /**< candidates under DETECT_HIT_MIN_MS */
+    uint16_t rejected_long;         /**< candidates at or over DETECT_HIT_MAX_MS */
+    uint16_t rejected_flash;        /**< candidates shaped like a flash */
+    uint16_t release_max;           /**< worst last-above-threshold to decision */
+    uint16_t hist[STATS_BINS];      /**< candidate length, STATS_BIN_MS per bin */
+} DetectStats;
+
+/**
+@brief Clear the statistics and set up the histogram bin width
+@details
+The bin width is converted to scheduler ticks here so the scheduler must
+already be initialized.
+*/
+extern void StatsInit(void);
+
+/**
+@brief Record a finished hit candidate
+@details
+Called by the detector on the sample that ends a candidate, which is also when
+STUN is published for an accepted hit. The histogram is binned by the time from
+first-above-threshold to that sample, the same span the hit window checks.
+The bin is found by repeated subtraction, at most STATS_BINS steps.
+@param[in] first time of the first sample above threshold
+@param[in] last time of the last sample above threshold
+@param[in] end time of the sample that ended the candidate
+@param[in] result how the candidate was judged
+*/
+extern void StatsCandidate(uint32_t first, uint32_t last, uint32_t end, enum CandidateResult result);
+
+/**
+@brief Copy the statistics to information flash
+@details
+The target has no serial port so the statistics are written to information
+segment C, where a debugger can read them back (e.g. mspdebug "md 0x1040 64").
+Nothing is written, and the segment is not erased, unless a candidate has been
+counted since the last dump. That also keeps the last boot's statistics
+readable until this one has something to add. The CPU stalls while the segment is erased so do not call this from the
+scheduler.
+*/
+extern void StatsDump(void);
+
+#endif // STATS_H
@@ -0,0 +1,417 @@
+/**
+@file batch.c
+@brief Replay one trace for several detector settings at once
+@author Joe Brown
+*/
+#include "batch.h"
+#include "fixed.h"
+#include "schedule.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_HAVE_AVX2
+#endif
+
+/** @brief Everything each lane keeps, one array element per lane so the AVX2
+kernel can load a field for all lanes at once */
+typedef struct
+{
+    // detector state, as in detect.c
+    uint32_t red_mean[BATCH_LANES];
+    uint32_t red_dev[BATCH_LANES];
+    uint32_t green_mean[BATCH_LANES];
+    uint32_t green_dev[BATCH_LANES];
+    uint32_t red_thresh[BATCH_LANES];
+    uint32_t green_thresh[BATCH_LANES];
+    uint32_t candidate[BATCH_LANES];    /**< all ones or zero */
+    uint32_t rise_time[BATCH_LANES];
+    // replay state, as in ReplayRun
+    uint32_t listen_at[BATCH_LANES];
+    uint32_t next_sample[BATCH_LANES];
+    uint32_t samples[BATCH_LANES];
+    // settings
+    uint32_t rise_shift[BATCH_LANES];
+    uint32_t fall_shift[BATCH_LANES];
+    uint32_t red_margin[BATCH_LANES];
+    uint32_t green_margin[BATCH_LANES];
+    uint32_t red_gain[BATCH_LANES];
+    uint32_t green_gain[BATCH_LANES];
+    uint32_t hit_min_time[BATCH_LANES];
+    uint32_t hit_max_time[BATCH_LANES];
+    uint32_t period_ms[BATCH_LANES];
+    uint32_t stun_ms;
+} __attribute__((aligned(32))) Lanes;
+
+/**
+@brief Run one sample through every lane
+@param[in,out] l lane state
+@param[in] ms sample time
+@param[in] ticks sample time in scheduler ticks
+@param[in] red raw red
+@param[in] green raw green
+@param[out] listening bit per lane, set if the lane was detecting
+@return bit per lane, set if the lane reported a hit
+*/
+typedef uint32_t (*StepFn)(Lanes* l, uint32_t ms, uint32_t ticks, uint32_t red,
+                           uint32_t green, uint32_t* listening);
+
+static uint32_t StepScalar(Lanes* l, uint32_t ms, uint32_t ticks, uint32_t red,
+                           uint32_t green, uint32_t* listening);
+#ifdef BATCH_HAVE_AVX2
+static uint32_t StepAvx2(Lanes* l, uint32_t ms, uint32_t ticks, uint32_t red,
+                         uint32_t green, uint32_t* listening);
+#endif
+
+/**
+@brief BaselineUpdate from detect.c for one lane
+*/
+static void ScalarBaseline(uint32_t* mean, uint32_t* dev, uint32_t sample,
+                           uint32_t rise_shift, uint32_t fall_shift);
+
+/**
+@brief One threshold from ThresholdUpdate in detect.c
+*/
+static uint32_t ScalarThreshold(uint32_t mean, uint32_t dev, uint32_t margin,
+                                uint32_t gain);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint8_t BatchSupported(void)
+{
+#if DETECT_MODE == DETECT_MODE_THRESHOLD && DETECT_DROPOUT_SAMPLES == 0 && \
+    !defined(DETECT_PULSE_CODE) && !defined(DETECT_FLASH_REJECT) && \
+    !defined(DETECT_DECIMATE) && !defined(DETECT_LEARN)
+    return (TRUE);
+#else
+    return (FALSE);
+#endif
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint8_t BatchAvx2(void)
+{
+#ifdef BATCH_HAVE_AVX2
+    return (__builtin_cpu_supports("avx2") ? TRUE : FALSE);
+#else
+    return (FALSE);
+#endif
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t BatchRun(const Trace* trace, const ReplayConfig* cfg,
+                const TunePoint* points, uint8_t count,
+                ReplayResult* results, enum BatchKernel kernel,
+                ReplayDecisionFn report, void* ctx)
+{
+    Lanes l;
+    ReplayScore score;
+    TraceCursor cursor;
+    const TraceSample* t = NULL;
+    StepFn step = StepScalar;
+    uint32_t listen_at = 0;
+    uint16_t red = 0;
+    uint16_t green = 0;
+    uint8_t i = 0;
+
+    if (count == 0 || count > BATCH_LANES)
+    {
+        return (FAILURE);
+    }
+#ifdef BATCH_HAVE_AVX2
+    if (kernel == BATCH_KERNEL_AVX2)
+    {
+        step = StepAvx2;
+    }
+#endif
+    memset(results, 0, count * sizeof(ReplayResult));
+    if (ReplayAmbient(trace, &red, &green, &listen_at) != SUCCESS)
+    {
+        return (FAILURE);
+    }
+    listen_at += REPLAY_STARTUP_MS;
+
+    // Unused lanes run a copy of the last point and are never scored
+    memset(&l, 0, sizeof(l));
+    l.stun_ms = cfg->stun_ms;
+    for (i = 0;i < BATCH_LANES;i++)
+    {
+        const TunePoint* p = &points[(i < count) ? i : count - 1];
+        l.rise_shift[i]   = p->tune.rise_shift;
+        l.fall_shift[i]   = p->tune.fall_shift;
+        l.red_margin[i]   = p->tune.red_margin;
+        l.green_margin[i] = p->tune.green_margin;
+        l.red_gain[i]     = p->tune.red_gain;
+        l.green_gain[i]   = p->tune.green_gain;
+        l.hit_min_time[i] = SCHEDULE_TICKS(p->tune.hit_min_ms);
+        l.hit_max_time[i] = SCHEDULE_TICKS(p->tune.hit_max_ms);
+        l.period_ms[i]    = p->period_ms;
+        // DetectInit
+        l.red_mean[i]     = (uint32_t)red << DETECT_BASELINE_FRAC;
+        l.green_mean[i]   = (uint32_t)green << DETECT_BASELINE_FRAC;
+        l.red_thresh[i]   = ScalarThreshold(l.red_mean[i], 0, l.red_margin[i], l.red_gain[i]);
+        l.green_thresh[i] = ScalarThreshold(l.green_mean[i], 0, l.green_margin[i], l.green_gain[i]);
+        l.listen_at[i]    = listen_at;
+        l.next_sample[i]  = listen_at;
+    }
+
+    ReplayScoreBegin(&score, cfg, results, count, report, ctx);
+    TraceBegin(trace, &cursor);
+    while ((t = TraceNext(&cursor)) != NULL)
+    {
+        uint32_t listening = 0;
+        uint32_t hits = step(&l, t->ms, REPLAY_TICKS(t->ms), t->red, t->green, &listening);
+        if (ReplayScoreSample(&score, t, listening) != SUCCESS)
+        {
+            ReplayScoreEnd(&score);
+            return (FAILURE);
+        }
+        hits &= _BV(count) - 1;
+        while (hits)
+        {
+            i = __builtin_ctz(hits);
+            ReplayScoreHit(&score, i, t->ms, NULL);
+            hits &= hits - 1;
+        }
+    }
+    ReplayScoreEnd(&score);
+    for (i = 0;i < count;i++)
+    {
+        results[i].samples = l.samples[i];
+        results[i].duration_ms = trace->last_ms - trace->first_ms;
+    }
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                 Scalar
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void ScalarBaseline(uint32_t* mean, uint32_t* dev, uint32_t sample,
+                    uint32_t rise_shift, uint32_t fall_shift)
+{
+    uint32_t x = sample << DETECT_BASELINE_FRAC;
+    uint32_t diff = 0;
+    if (*mean == 0)
+    {
+        *mean = x;
+    }
+    if (x > *mean)
+    {
+        diff = x - *mean;
+        *mean += diff >> rise_shift;
+    }
+    else
+    {
+        diff = *mean - x;
+        *mean -= diff >> fall_shift;
+    }
+    if (diff > *dev)
+    {
+        *dev += (diff - *dev) >> DETECT_NOISE_SHIFT;
+    }
+    else
+    {
+        *dev -= (*dev - diff) >> DETECT_NOISE_SHIFT;
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint32_t ScalarThreshold(uint32_t mean, uint32_t dev, uint32_t margin, uint32_t gain)
+{
+    uint32_t base  = mean >> DETECT_BASELINE_FRAC;
+    uint32_t noise = dev  >> DETECT_BASELINE_FRAC;
+    uint32_t t = base + FIXED_FRAC16(base, margin) + (noise << gain);
+    return FIXED_SAT16(t);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint32_t StepScalar(Lanes* l, uint32_t ms, uint32_t ticks, uint32_t red,
+                    uint32_t green, uint32_t* listening)
+{
+    uint32_t ret = 0;
+    uint8_t i = 0;
+    *listening = 0;
+    for (i = 0;i < BATCH_LANES;i++)
+    {
+        uint32_t hit = 0;
+        uint32_t on_time = 0;
+        if (ms < l->listen_at[i])
+        {
+            continue;
+        }
+        *listening |= _BV(i);
+        if (ms < l->next_sample[i])
+        {
+            continue;
+        }
+        l->next_sample[i] = ms + l->period_ms[i];
+        l->samples[i]++;
+
+        // DetectSample
+        hit = (red > l->red_thresh[i]) && (green < l->green_thresh[i]);
+        if (l->candidate[i])
+        {
+            on_time = ticks - l->rise_time[i];
+            if (!hit && on_time >= l->hit_min_time[i] && on_time < l->hit_max_time[i])
+            {
+                ret |= _BV(i);
+            }
+        }
+        else if (hit)
+        {
+            l->candidate[i] = 0xFFFFFFFF;
+            l->rise_time[i] = ticks;
+        }
+        if (!l->candidate[i] || on_time >= l->hit_max_time[i])
+        {
+            ScalarBaseline(&l->red_mean[i], &l->red_dev[i], red,
+                           l->rise_shift[i], l->fall_shift[i]);
+            ScalarBaseline(&l->green_mean[i], &l->green_dev[i], green,
+                           l->rise_shift[i], l->fall_shift[i]);
+            l->red_thresh[i] = ScalarThreshold(l->red_mean[i], l->red_dev[i],
+                                               l->red_margin[i], l->red_gain[i]);
+            l->green_thresh[i] = ScalarThreshold(l->green_mean[i], l->green_dev[i],
+                                                 l->green_margin[i], l->green_gain[i]);
+        }
+        if (!hit)
+        {
+            l->candidate[i] = 0;
+        }
+
+        // Stunned
+        if (ret & _BV(i))
+        {
+            l->listen_at[i] = ms + l->stun_ms;
+            l->next_sample[i] = l->listen_at[i];
+        }
+    }
+    return (ret);
+}
+
+#ifdef BATCH_HAVE_AVX2
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  AVX2
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+#define AVX2 __attribute__((target("avx2")))
+#define LOAD(f)         _mm256_load_si256((const __m256i*)(f))
+#define STORE(f,v)      _mm256_store_si256((__m256i*)(f), (v))
+#define BLEND(a,b,m)    _mm256_blendv_epi8((a), (b), (m))
+
+/**
+@brief Unsigned a >= b in every lane
+*/
+static inline AVX2 __m256i GreaterEqual(__m256i a, __m256i b)
+{
+    return _mm256_cmpeq_epi32(_mm256_max_epu32(a, b), a);
+}
+
+/**
+@brief Vector BaselineUpdate
+*/
+static inline AVX2 void VectorBaseline(__m256i* mean, __m256i* dev, __m256i x,
+                                       __m256i rise_shift, __m256i fall_shift)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i m = BLEND(*mean, x, _mm256_cmpeq_epi32(*mean, zero));
+    __m256i up = _mm256_andnot_si256(GreaterEqual(m, x), _mm256_set1_epi32(-1));
+    __m256i diff = _mm256_sub_epi32(_mm256_max_epu32(x, m), _mm256_min_epu32(x, m));
+    __m256i d = *dev;
+    __m256i grow = _mm256_andnot_si256(GreaterEqual(d, diff), _mm256_set1_epi32(-1));
+    __m256i step = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_max_epu32(diff, d),
+                                                      _mm256_min_epu32(diff, d)),
+                                     DETECT_NOISE_SHIFT);
+    *mean = BLEND(_mm256_sub_epi32(m, _mm256_srlv_epi32(diff, fall_shift)),
+                  _mm256_add_epi32(m, _mm256_srlv_epi32(diff, rise_shift)), up);
+    *dev = BLEND(_mm256_sub_epi32(d, step), _mm256_add_epi32(d, step), grow);
+}
+
+/**
+@brief Vector threshold, FRAC16 one bit of the margin at a time
+*/
+static inline AVX2 __m256i VectorThreshold(__m256i mean, __m256i dev,
+                                           __m256i margin, __m256i gain)
+{
+    __m256i base = _mm256_srli_epi32(mean, DETECT_BASELINE_FRAC);
+    __m256i noise = _mm256_srli_epi32(dev, DETECT_BASELINE_FRAC);
+    __m256i t = _mm256_add_epi32(base, _mm256_sllv_epi32(noise, gain));
+#define FRAC_BIT(bit, shift) \
+    t = _mm256_add_epi32(t, _mm256_and_si256(_mm256_srli_epi32(base, shift), \
+            _mm256_cmpeq_epi32(_mm256_and_si256(margin, _mm256_set1_epi32(bit)), \
+                               _mm256_set1_epi32(bit))))
+    FRAC_BIT(16, 0);
+    FRAC_BIT(8, 1);
+    FRAC_BIT(4, 2);
+    FRAC_BIT(2, 3);
+    FRAC_BIT(1, 4);
+#undef FRAC_BIT
+    return _mm256_min_epu32(t, _mm256_set1_epi32(0xFFFF));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+AVX2 uint32_t StepAvx2(Lanes* l, uint32_t ms, uint32_t ticks, uint32_t red,
+                       uint32_t green, uint32_t* listening)
+{
+    const __m256i ones = _mm256_set1_epi32(-1);
+    const __m256i vms = _mm256_set1_epi32(ms);
+    const __m256i vticks = _mm256_set1_epi32(ticks);
+    const __m256i vred = _mm256_set1_epi32(red);
+    const __m256i vgreen = _mm256_set1_epi32(green);
+    __m256i listen = GreaterEqual(vms, LOAD(l->listen_at));
+    __m256i active = _mm256_and_si256(listen, GreaterEqual(vms, LOAD(l->next_sample)));
+    __m256i candidate, on_time, hit, ret, start, learn, stun;
+    __m256i red_mean, red_dev, green_mean, green_dev, max_time;
+
+    *listening = _mm256_movemask_ps(_mm256_castsi256_ps(listen));
+    if (_mm256_testz_si256(active, active))
+    {
+        return (0);
+    }
+    STORE(l->next_sample, BLEND(LOAD(l->next_sample),
+                                _mm256_add_epi32(vms, LOAD(l->period_ms)), active));
+    STORE(l->samples, _mm256_sub_epi32(LOAD(l->samples), active));
+
+    // DetectSample
+    hit = _mm256_and_si256(_mm256_cmpgt_epi32(vred, LOAD(l->red_thresh)),
+                           _mm256_cmpgt_epi32(LOAD(l->green_thresh), vgreen));
+    candidate = LOAD(l->candidate);
+    max_time = LOAD(l->hit_max_time);
+    on_time = _mm256_and_si256(candidate, _mm256_sub_epi32(vticks, LOAD(l->rise_time)));
+    ret = _mm256_and_si256(_mm256_andnot_si256(hit, candidate),
+                           _mm256_andnot_si256(GreaterEqual(on_time, max_time),
+                                               GreaterEqual(on_time, LOAD(l->hit_min_time))));
+    ret = _mm256_and_si256(ret, active);
+    start = _mm256_and_si256(_mm256_andnot_si256(candidate, hit), active);
+    STORE(l->rise_time, BLEND(LOAD(l->rise_time), vticks, start));
+    learn = _mm256_or_si256(_mm256_xor_si256(_mm256_or_si256(candidate, start), ones),
+                            GreaterEqual(on_time, max_time));
+    learn = _mm256_and_si256(learn, active);
+    if (!_mm256_testz_si256(learn, learn))
+    {
+        __m256i rise_shift = LOAD(l->rise_shift);
+        __m256i fall_shift = LOAD(l->fall_shift);
+        red_mean = LOAD(l->red_mean);
+        red_dev = LOAD(l->red_dev);
+        green_mean = LOAD(l->green_mean);
+        green_dev = LOAD(l->green_dev);
+        VectorBaseline(&red_mean, &red_dev,
+                       _mm256_slli_epi32(vred, DETECT_BASELINE_FRAC), rise_shift, fall_shift);
+        VectorBaseline(&green_mean, &green_dev,
+                       _mm256_slli_epi32(vgreen, DETECT_BASELINE_FRAC), rise_shift, fall_shift);
+        STORE(l->red_mean, BLEND(LOAD(l->red_mean), red_mean, learn));
+        STORE(l->red_dev, BLEND(LOAD(l->red_dev), red_dev, learn));
+        STORE(l->green_mean, BLEND(LOAD(l->green_mean), green_mean, learn));
+        STORE(l->green_dev, BLEND(LOAD(l->green_dev), green_dev, learn));
+        STORE(l->red_thresh, BLEND(LOAD(l->red_thresh),
+                                   VectorThreshold(red_mean, red_dev, LOAD(l->red_margin),
+                                                   LOAD(l->red_gain)), learn));
+        STORE(l->green_thresh, BLEND(LOAD(l->green_thresh),
+                                     VectorThreshold(green_mean, green_dev, LOAD(l->green_margin),
+                                                     LOAD(l->green_gain)), learn));
+    }
+    STORE(l->candidate, BLEND(candidate, hit, active));
+
+    // Stunned
+    stun = _mm256_add_epi32(vms, _mm256_set1_epi32(l->stun_ms));
+    STORE(l->listen_at, BLEND(LOAD(l->listen_at), stun, ret));
+    STORE(l->next_sample, BLEND(LOAD(l->next_sample), stun, ret));
+    return (_mm256_movemask_ps(_mm256_castsi256_ps(ret)));
+}
+#endif
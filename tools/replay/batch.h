@@ -0,0 +1,65 @@
+/**
+@file batch.h
+@brief Replay one trace for several detector settings at once
+@author Joe Brown
+@details
+A second implementation of the THRESHOLD detector (baselines, thresholds,
+comparator and hit window) and of what ReplayRun does around it, with one lane
+per setting so a whole group shares a single pass over the trace. The scalar
+kernel is written to follow detect.c line for line and is the reference. The
+AVX2 kernel runs all eight lanes in one set of vector registers and must match
+the scalar one bit for bit. batchcheck holds both to the firmware detector.
+
+Only the default detector can be batched. With another DETECT_MODE, pulse
+codes, flash rejection, DETECT_FAST, DETECT_DECIMATE or DETECT_LEARN
+configured BatchSupported is FALSE and the sweep runs the firmware detector
+instead.
+*/
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "replay.h"
+#include "tune.h"
+
+#define BATCH_LANES     8
+
+enum BatchKernel
+{
+    BATCH_KERNEL_SCALAR,
+    BATCH_KERNEL_AVX2
+};
+
+/**
+@brief Check if the detector in config.h is one the kernels implement
+@return TRUE or FALSE
+*/
+extern uint8_t BatchSupported(void);
+
+/**
+@brief Check if this build and this CPU can run the AVX2 kernel
+@return TRUE or FALSE
+*/
+extern uint8_t BatchAvx2(void);
+
+/**
+@brief Replay a trace for up to BATCH_LANES settings
+@details
+Gives the same results as setting g_tune and period_ms from each point in
+turn and calling ReplayRun, except that hit details (peak, confidence and so
+on) are not measured. Noise gains must be below 32 so every shift is defined.
+@param[in] trace recording to run
+@param[in] cfg stun and tolerance, the period comes from each point
+@param[in] points settings for each lane
+@param[in] count number of points, 1 to BATCH_LANES
+@param[out] results one per point, cleared first
+@param[in] kernel which implementation to run
+@param[in] report told about every decision, lane is the point, may be NULL
+@param[in] ctx passed through to report
+@return SUCCESS, or FAILURE if the trace is too short to calibrate
+*/
+extern int8_t BatchRun(const Trace* trace, const ReplayConfig* cfg,
+                       const TunePoint* points, uint8_t count,
+                       ReplayResult* results, enum BatchKernel kernel,
+                       ReplayDecisionFn report, void* ctx);
+
+#endif // BATCH_H
@@ -0,0 +1,379 @@
+/**
+@file batchcheck.c
+@brief Hold the batch kernels to the firmware detector
+@author Joe Brown
+@details
+    batchcheck [-n points] [-r seed] [trace ...]
+
+Replays synthetic traces, and any traces given, for random detector settings
+three ways: through detect.c one setting at a time as the sweep used to, and
+through the scalar and AVX2 batch kernels. Every result and every decision
+(outcome, time and shot) must be the same from all three. Prints how fast each
+ran and exits non zero on the first difference.
+*/
+#include <time.h>
+#include <unistd.h>
+#include "batch.h"
+#include "fixed.h"
+
+#define CHECK_TRACES        4
+#define CHECK_TRACE_MS      120000
+#define CHECK_MAX_DECISIONS 4096
+
+/** @brief Decisions one setting made on one trace */
+typedef struct
+{
+    uint32_t       count;
+    ReplayDecision d[CHECK_MAX_DECISIONS];
+} Decisions;
+
+static uint32_t  seed = 1;
+static Decisions got[BATCH_LANES];
+static Decisions want[BATCH_LANES];
+
+/**
+@brief xorshift32, so every run checks the same cases
+*/
+static uint32_t Random(void);
+
+/**
+@brief Random value from lo to hi inclusive
+*/
+static uint32_t RandomRange(uint32_t lo, uint32_t hi);
+
+/**
+@brief Build a labeled trace with drift, noise, shots, flashes and lighting
+changes in it
+@return SUCCESS, or FAILURE when out of memory
+*/
+static int8_t Synthesize(Trace* trace, uint32_t n);
+
+/**
+@brief Random detector settings, kept to where every shift is defined
+*/
+static void RandomPoint(TunePoint* p);
+
+/**
+@brief ReplayDecisionFn that records into an array of Decisions by lane
+*/
+static void Record(const ReplayDecision* d, void* ctx);
+
+/**
+@brief Compare a run with the reference and print the first difference
+@return SUCCESS if they are the same
+*/
+static int8_t Compare(const char* what, const Trace* trace, uint8_t lane,
+                      const ReplayResult* a, const ReplayResult* b,
+                      const Decisions* da, const Decisions* db);
+
+/**
+@brief Seconds since some fixed point
+*/
+static double Now(void);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Entry
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int main(int argc, char** argv)
+{
+    uint32_t points = 256;
+    double elapsed[3] = {0, 0, 0};
+    uint64_t work = 0;
+    TunePoint p[BATCH_LANES];
+    ReplayResult want_r[BATCH_LANES];
+    ReplayResult got_r[BATCH_LANES];
+    ReplayConfig cfg;
+    TraceSet set;
+    Trace synthetic[CHECK_TRACES];
+    uint32_t g = 0;
+    uint32_t t = 0;
+    uint8_t kernels = BatchAvx2() ? 2 : 1;
+    uint8_t count = 0;
+    uint8_t i = 0;
+    uint8_t k = 0;
+    int opt = 0;
+
+    TraceSetInit(&set);
+    while ((opt = getopt(argc, argv, "n:r:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': points = strtoul(optarg, NULL, 0); break;
+            case 'r': seed = strtoul(optarg, NULL, 0) | 1; break;
+            default:
+                fprintf(stderr, "usage: %s [-n points] [-r seed] [trace ...]\n", argv[0]);
+                return (2);
+        }
+    }
+    if (!BatchSupported())
+    {
+        printf("batchcheck: config.h detector is not batched, nothing to check\n");
+        return (0);
+    }
+    for (t = 0;t < CHECK_TRACES;t++)
+    {
+        if (Synthesize(&synthetic[t], t) != SUCCESS)
+        {
+            fprintf(stderr, "%s: out of memory\n", argv[0]);
+            return (1);
+        }
+    }
+    for (;optind < argc;optind++)
+    {
+        if (TraceSetAdd(&set, argv[optind]) != SUCCESS)
+        {
+            return (1);
+        }
+    }
+
+    ReplayDefaults(&cfg);
+    for (g = 0;g < points;g += BATCH_LANES)
+    {
+        count = (points - g < BATCH_LANES) ? points - g : BATCH_LANES;
+        for (i = 0;i < count;i++)
+        {
+            RandomPoint(&p[i]);
+        }
+        for (t = 0;t < CHECK_TRACES + set.count;t++)
+        {
+            const Trace* trace = (t < CHECK_TRACES) ? &synthetic[t] :
+                                 &set.traces[t - CHECK_TRACES];
+            int8_t want_ok = SUCCESS;
+            double start = Now();
+            for (i = 0;i < count;i++)
+            {
+                g_tune = p[i].tune;
+                cfg.period_ms = p[i].period_ms;
+                want[i].count = 0;
+                want_ok = ReplayRun(trace, &cfg, &want_r[i], Record, &want[i]);
+            }
+            elapsed[0] += Now() - start;
+            work += (uint64_t)trace->count * count;
+
+            for (k = 0;k < kernels;k++)
+            {
+                int8_t got_ok = FAILURE;
+                memset(got, 0, sizeof(got));
+                start = Now();
+                got_ok = BatchRun(trace, &cfg, p, count, got_r,
+                                  k ? BATCH_KERNEL_AVX2 : BATCH_KERNEL_SCALAR,
+                                  Record, got);
+                elapsed[k + 1] += Now() - start;
+                if (got_ok != want_ok)
+                {
+                    fprintf(stderr, "%s: %s kernel returned %d, firmware %d\n",
+                            trace->name, k ? "avx2" : "scalar", got_ok, want_ok);
+                    return (1);
+                }
+                for (i = 0;want_ok == SUCCESS && i < count;i++)
+                {
+                    if (Compare(k ? "avx2" : "scalar", trace, i, &want_r[i], &got_r[i],
+                                &want[i], &got[i]) != SUCCESS)
+                    {
+                        return (1);
+                    }
+                }
+            }
+        }
+    }
+
+    printf("%u settings x %u traces agree\n", points, CHECK_TRACES + set.count);
+    printf("  firmware %8.2f Msample/s\n", work / elapsed[0] / 1e6);
+    printf("  scalar   %8.2f Msample/s\n", work / elapsed[1] / 1e6);
+    if (kernels > 1)
+    {
+        printf("  avx2     %8.2f Msample/s\n", work / elapsed[2] / 1e6);
+    }
+    for (t = 0;t < CHECK_TRACES;t++)
+    {
+        free(synthetic[t].samples);
+        free(synthetic[t].name);
+    }
+    TraceSetFree(&set);
+    return (0);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint32_t Random(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return (seed);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint32_t RandomRange(uint32_t lo, uint32_t hi)
+{
+    return lo + Random() % (hi - lo + 1);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t Synthesize(Trace* trace, uint32_t n)
+{
+    uint32_t capacity = CHECK_TRACE_MS;
+    uint32_t ms = 0;
+    uint32_t event_at = 3000;
+    uint32_t event_end = 0;
+    uint32_t red = RandomRange(200, 3000);
+    uint32_t green = RandomRange(200, 3000);
+    uint32_t add_red = 0;
+    uint32_t add_green = 0;
+    uint8_t truth = 0;
+    char name[32];
+
+    memset(trace, 0, sizeof(*trace));
+    snprintf(name, sizeof(name), "synthetic%u", n);
+    trace->name = strdup(name);
+    trace->samples = malloc(capacity * sizeof(TraceSample));
+    if (!trace->name || !trace->samples)
+    {
+        return (FAILURE);
+    }
+    while (ms < CHECK_TRACE_MS)
+    {
+        TraceSample* s = &trace->samples[trace->count++];
+        uint32_t noise = red / 64 + 2;
+
+        if (ms >= event_end && (truth | add_red | add_green))
+        {
+            truth = 0;
+            add_red = 0;
+            add_green = 0;
+            event_at = ms + RandomRange(300, 4000);
+        }
+        if (ms >= event_at)
+        {
+            switch (Random() % 6)
+            {
+                // Laser shots of every length, in and out of the hit window
+                case 0:
+                case 1:
+                case 2:
+                    truth = 1;
+                    add_red = RandomRange(red / 8, red * 2);
+                    add_green = RandomRange(0, green / 16);
+                    event_end = ms + RandomRange(5, 300);
+                    break;
+                // Flashes and white light
+                case 3:
+                    add_red = RandomRange(red / 4, red * 3);
+                    add_green = RandomRange(green / 4, green * 3);
+                    event_end = ms + RandomRange(5, 200);
+                    break;
+                // Lighting changes the baseline has to follow
+                case 4:
+                    red = RandomRange(200, 3000);
+                    green = RandomRange(200, 3000);
+                    break;
+                // Very long red light
+                default:
+                    add_red = RandomRange(red / 4, red);
+                    event_end = ms + RandomRange(500, 3000);
+                    break;
+            }
+            event_at = 0xFFFFFFFF;
+            if (!add_red && !add_green)
+            {
+                event_at = ms + RandomRange(300, 4000);
+            }
+        }
+
+        // Slow drift
+        if (Random() % 64 == 0)
+        {
+            red = (Random() & 1) ? red + 1 : red - (red > 100);
+            green = (Random() & 1) ? green + 1 : green - (green > 100);
+        }
+        s->ms    = ms;
+        s->red   = FIXED_SAT16(red + add_red + Random() % noise);
+        s->green = FIXED_SAT16(green + add_green + Random() % noise);
+        s->blue  = green / 2;
+        s->clear = FIXED_SAT16((uint32_t)s->red + s->green);
+        s->truth = truth;
+        ms += RandomRange(1, 12);
+        if (trace->count == capacity)
+        {
+            break;
+        }
+    }
+    trace->first_ms = trace->samples[0].ms;
+    trace->last_ms = trace->samples[trace->count - 1].ms;
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void RandomPoint(TunePoint* p)
+{
+    static const uint32_t periods[] = {0, 10, 25, REPLAY_CHECK_MS};
+    TuneDefaults();
+    p->tune = g_tune;
+    p->tune.hit_min_ms   = RandomRange(0, 80);
+    p->tune.hit_max_ms   = RandomRange(p->tune.hit_min_ms, 400);
+    p->tune.red_margin   = RandomRange(0, 31);
+    p->tune.green_margin = RandomRange(0, 31);
+    p->tune.red_gain     = RandomRange(0, 8);
+    p->tune.green_gain   = RandomRange(0, 8);
+    p->tune.rise_shift   = RandomRange(0, 12);
+    p->tune.fall_shift   = RandomRange(0, 12);
+    p->period_ms = periods[Random() % 4];
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void Record(const ReplayDecision* d, void* ctx)
+{
+    Decisions* lanes = ctx;
+    Decisions* dest = &lanes[d->lane];
+    if (dest->count < CHECK_MAX_DECISIONS)
+    {
+        dest->d[dest->count] = *d;
+    }
+    dest->count++;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t Compare(const char* what, const Trace* trace, uint8_t lane,
+               const ReplayResult* a, const ReplayResult* b,
+               const Decisions* da, const Decisions* db)
+{
+    uint32_t i = 0;
+    if (a->samples != b->samples || a->duration_ms != b->duration_ms ||
+        a->shots != b->shots || a->masked != b->masked || a->hits != b->hits ||
+        a->misses != b->misses || a->false_hits != b->false_hits ||
+        a->latency_sum != b->latency_sum || a->latency_max != b->latency_max)
+    {
+        fprintf(stderr, "%s lane %u: %s kernel results differ\n"
+                "  firmware samples %u shots %u masked %u hits %u misses %u false %u\n"
+                "  %-8s samples %u shots %u masked %u hits %u misses %u false %u\n",
+                trace->name, lane, what,
+                a->samples, a->shots, a->masked, a->hits, a->misses, a->false_hits, what,
+                b->samples, b->shots, b->masked, b->hits, b->misses, b->false_hits);
+        return (FAILURE);
+    }
+    if (da->count != db->count)
+    {
+        fprintf(stderr, "%s lane %u: %s kernel made %u decisions, firmware %u\n",
+                trace->name, lane, what, db->count, da->count);
+        return (FAILURE);
+    }
+    for (i = 0;i < da->count && i < CHECK_MAX_DECISIONS;i++)
+    {
+        if (da->d[i].outcome != db->d[i].outcome || da->d[i].ms != db->d[i].ms ||
+            da->d[i].shot_start != db->d[i].shot_start ||
+            da->d[i].shot_end != db->d[i].shot_end)
+        {
+            fprintf(stderr, "%s lane %u: %s kernel decision %u differs\n",
+                    trace->name, lane, what, i);
+            return (FAILURE);
+        }
+    }
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
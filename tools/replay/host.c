@@ -0,0 +1,30 @@
+/**
+@file host.c
+@brief Globals and drivers the detection modules expect from the firmware
+@author Joe Brown
+*/
+#include "global.h"
+#include "schedule.h"
+#include "flash.h"
+
+// The firmware runs at 8MHz
+volatile uint32_t g_clock_speed = 8000000;
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t FlashWriteSegment(uint8_t* segment, const void* src, uint8_t len)
+{
+    // Statistics and capture dumps have nowhere to go on the host
+    (void)segment;
+    (void)src;
+    (void)len;
+    return (SUCCESS);
+}
+
+#if defined(SCHEDULE_TICKLESS) && defined(SCHEDULE_ACLK_VLO)
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint32_t ScheduleMsToTicks(uint32_t ms)
+{
+    // The target measures its VLO at boot, a trace runs at the nominal rate
+    return ((uint32_t)((uint64_t)ms * SCHEDULE_ACLK_HZ / 1000));
+}
+#endif
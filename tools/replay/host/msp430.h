@@ -0,0 +1,20 @@
+/**
+@file msp430.h
+@brief Stand-in for the compiler's device header in host builds
+@author Joe Brown
+@details
+The detection modules only need the keywords and intrinsics below. Anything
+that touches a peripheral register is left out on purpose so pulling hardware
+code into a host build fails at compile time instead of at run time.
+*/
+#ifndef HOST_MSP430_H
+#define HOST_MSP430_H
+
+#define __interrupt
+#define _NOP()
+#define _EINT()
+#define _DINT()
+#define GIE                     0x0008
+#define __get_SR_register()     0
+
+#endif // HOST_MSP430_H
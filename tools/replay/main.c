@@ -0,0 +1,140 @@
+/**
+@file main.c
+@brief Replay recorded sensor traces through the hit detector
+@author Joe Brown
+@details
+    replay [-p period_ms] [-s stun_ms] [-t tolerance_ms] [-T target]
+           [-S session] [-v] trace...
+
+Prints the hits, misses and false hits for each trace and the totals, with
+how much faster than real time the replay ran. -v lists every decision. -T
+and -S pick recordings out of packed traces.
+*/
+#include <time.h>
+#include <unistd.h>
+#include "replay.h"
+
+static const char* outcome_names[] = {"HIT", "FALSE", "MISS"};
+
+/**
+@brief Print one decision for -v
+*/
+static void PrintDecision(const ReplayDecision* d, void* ctx);
+
+/**
+@brief Print a result line
+*/
+static void PrintResult(const char* name, const ReplayResult* r);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Entry
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int main(int argc, char** argv)
+{
+    ReplayConfig cfg;
+    ReplayResult total;
+    TraceSet set;
+    uint32_t i = 0;
+    struct timespec t0, t1;
+    double elapsed = 0;
+    uint8_t verbose = FALSE;
+    int ret = 0;
+    int opt = 0;
+
+    ReplayDefaults(&cfg);
+    TraceSetInit(&set);
+    while ((opt = getopt(argc, argv, "p:s:t:T:S:v")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p': cfg.period_ms    = strtoul(optarg, NULL, 0); break;
+            case 's': cfg.stun_ms      = strtoul(optarg, NULL, 0); break;
+            case 't': cfg.tolerance_ms = strtoul(optarg, NULL, 0); break;
+            case 'T': set.target       = strtol(optarg, NULL, 0); break;
+            case 'S': set.session      = strtol(optarg, NULL, 0); break;
+            case 'v': verbose = TRUE; break;
+            default:
+                fprintf(stderr, "usage: %s [-p period_ms] [-s stun_ms] "
+                        "[-t tolerance_ms] [-T target] [-S session] [-v] "
+                        "trace...\n", argv[0]);
+                return (2);
+        }
+    }
+    if (optind == argc)
+    {
+        fprintf(stderr, "%s: no traces given\n", argv[0]);
+        return (2);
+    }
+
+    memset(&total, 0, sizeof(total));
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (;optind < argc;optind++)
+    {
+        if (TraceSetAdd(&set, argv[optind]) != SUCCESS)
+        {
+            ret = 1;
+        }
+    }
+    for (i = 0;i < set.count;i++)
+    {
+        const Trace* trace = &set.traces[i];
+        ReplayResult r;
+        if (verbose)
+        {
+            printf("%s\n", trace->name);
+        }
+        if (ReplayRun(trace, &cfg, &r, verbose ? PrintDecision : NULL, NULL) != SUCCESS)
+        {
+            fprintf(stderr, "%s: too short to calibrate\n", trace->name);
+            ret = 1;
+        }
+        else
+        {
+            PrintResult(trace->name, &r);
+            ReplayAccumulate(&total, &r);
+        }
+    }
+    TraceSetFree(&set);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    PrintResult("total", &total);
+    printf("replayed %.1f s of recording in %.3f s (%.0fx real time)\n",
+           total.duration_ms / 1000.0, elapsed,
+           elapsed > 0 ? total.duration_ms / 1000.0 / elapsed : 0);
+    return (ret);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void PrintDecision(const ReplayDecision* d, void* ctx)
+{
+    (void)ctx;
+    printf("  %-5s %9u ms", outcome_names[d->outcome], d->ms);
+    if (d->outcome != REPLAY_FALSE)
+    {
+        printf("  shot %u-%u ms", d->shot_start, d->shot_end);
+    }
+    if (d->outcome == REPLAY_HIT)
+    {
+        printf("  latency %u ms", d->ms - d->shot_start);
+    }
+    if (d->outcome != REPLAY_MISS)
+    {
+        printf("  peak %u confidence %u color %u shooter %u",
+               d->hit.peak, d->hit.confidence, d->hit.color, d->hit.shooter);
+    }
+    printf("\n");
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void PrintResult(const char* name, const ReplayResult* r)
+{
+    printf("%s: %u samples, %u shots (%u masked), %u hit, %u missed, %u false",
+           name, r->samples, r->shots, r->masked, r->hits, r->misses, r->false_hits);
+    if (r->hits)
+    {
+        printf(", latency mean %u max %u ms",
+               (uint32_t)(r->latency_sum / r->hits), r->latency_max);
+    }
+    printf("\n");
+}
@@ -0,0 +1,480 @@
+/**
+@file regress.c
+@brief Regression run of the hit detector over the golden traces
+@author Joe Brown
+@details
+    regress [-u] [-d dir]
+
+Replays every trace listed in dir/MANIFEST (golden/ by default) and checks
+each decision against the one recorded in the .expect file beside the trace.
+It fails when a shot that used to hit is now missed, when there is a false
+hit that was not there before, when a hit moves by more than the tolerance
+for its trace, or when the expectations were written for another version of
+the traces. Hits and false hits that go away are reported as better but do
+not fail, rewrite the expectations with -u once the change is wanted.
+
+The manifest holds the version of the trace set and one trace per line:
+
+    version <n>
+    <trace file> <tolerance ms>
+
+Bump the version whenever a trace or its labels change.
+
+A build with a detector option that is meant to change some decisions is
+compiled with REGRESS_VARIANT set to a short name, and for each trace reads
+<trace>.<variant>.expect instead when there is one. -u in such a build only
+writes a variant file for traces whose decisions differ from the plain
+.expect, so a variant file is itself the record of what the option changes.
+*/
+#include <unistd.h>
+#include "replay.h"
+
+#define GOLDEN_DIR          "golden"
+#define GOLDEN_MAX_TRACES   64
+#define GOLDEN_PATH_LEN     512
+
+#ifndef REGRESS_VARIANT
+#define REGRESS_VARIANT     NULL
+#endif
+
+/** @brief One trace in the manifest */
+typedef struct
+{
+    char     name[128];
+    uint32_t tolerance_ms;
+} Entry;
+
+/** @brief Decisions made on one trace */
+typedef struct
+{
+    ReplayDecision* d;
+    uint32_t        count;
+    uint32_t        capacity;
+} Decisions;
+
+static const char* outcome_names[] = {"HIT", "FALSE", "MISS"};
+
+/**
+@brief Read the manifest
+@return number of traces, or -1 if it cannot be read
+*/
+static int32_t ManifestRead(const char* dir, uint32_t* version, Entry* entries);
+
+/**
+@brief ReplayDecisionFn that appends to a Decisions
+*/
+static void Record(const ReplayDecision* d, void* ctx);
+
+/**
+@brief Path of the .expect file for a trace
+@param[in] variant REGRESS_VARIANT for <trace>.<variant>.expect, NULL for the
+plain one
+*/
+static void ExpectPath(char* path, const char* dir, const char* name,
+                       const char* variant);
+
+/**
+@brief Check two lists hold the same decisions at the same times
+*/
+static uint8_t Same(const Decisions* a, const Decisions* b);
+
+/**
+@brief Write the decisions made on a trace as its expectations
+@return SUCCESS or FAILURE
+*/
+static int8_t ExpectWrite(const char* path, uint32_t version, const Decisions* got);
+
+/**
+@brief Read the expectations for a trace
+@return SUCCESS or FAILURE
+*/
+static int8_t ExpectRead(const char* path, uint32_t* version, Decisions* want);
+
+/**
+@brief Check the decisions made on a trace against its expectations
+@details
+Prints every regression and improvement.
+@return number of regressions
+*/
+static uint32_t Compare(const char* name, uint32_t tolerance_ms,
+                        const Decisions* want, const Decisions* got);
+
+/**
+@brief Find the hit or miss on a shot
+@return the decision, NULL if the shot was not scored
+*/
+static const ReplayDecision* FindShot(const Decisions* list, uint32_t shot_start);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Entry
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int main(int argc, char** argv)
+{
+    const char* dir = GOLDEN_DIR;
+    static Entry entries[GOLDEN_MAX_TRACES];
+    char path[GOLDEN_PATH_LEN];
+    char plain[GOLDEN_PATH_LEN];
+    const char* variant = REGRESS_VARIANT;
+    uint8_t update = FALSE;
+    uint32_t version = 0;
+    uint32_t failed = 0;
+    int32_t count = 0;
+    int32_t i = 0;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "ud:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'u': update = TRUE; break;
+            case 'd': dir = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-u] [-d dir]\n", argv[0]);
+                return (2);
+        }
+    }
+    if ((count = ManifestRead(dir, &version, entries)) < 0)
+    {
+        return (2);
+    }
+
+    for (i = 0;i < count;i++)
+    {
+        Decisions got = {NULL, 0, 0};
+        Decisions want = {NULL, 0, 0};
+        uint32_t want_version = 0;
+        ReplayConfig cfg;
+        ReplayResult r;
+        TraceSet set;
+
+        TraceSetInit(&set);
+        ReplayDefaults(&cfg);
+        if (snprintf(path, sizeof(path), "%s/%s", dir, entries[i].name) >= (int)sizeof(path) ||
+            TraceSetAdd(&set, path) != SUCCESS || set.count != 1 ||
+            ReplayRun(&set.traces[0], &cfg, &r, Record, &got) != SUCCESS)
+        {
+            fprintf(stderr, "%s: could not replay\n", path);
+            TraceSetFree(&set);
+            failed++;
+            continue;
+        }
+        TraceSetFree(&set);
+
+        ExpectPath(plain, dir, entries[i].name, NULL);
+        ExpectPath(path, dir, entries[i].name, variant);
+        if (!update && access(path, F_OK) != 0)
+        {
+            strcpy(path, plain);
+        }
+        if (update && variant &&
+            ExpectRead(plain, &want_version, &want) == SUCCESS &&
+            want_version == version && Same(&want, &got))
+        {
+            // Nothing for this variant to record, the plain file covers it
+            unlink(path);
+            printf("%-16s %u hit %u missed %u false, same as plain\n",
+                   entries[i].name, r.hits, r.misses, r.false_hits);
+        }
+        else if (update)
+        {
+            if (ExpectWrite(path, version, &got) != SUCCESS)
+            {
+                perror(path);
+                failed++;
+            }
+            printf("%-16s %u hit %u missed %u false, written\n",
+                   entries[i].name, r.hits, r.misses, r.false_hits);
+        }
+        else if (ExpectRead(path, &want_version, &want) != SUCCESS)
+        {
+            fprintf(stderr, "%s: no expectations, write them with -u\n", path);
+            failed++;
+        }
+        else if (want_version != version)
+        {
+            fprintf(stderr, "%s: written for version %u of the traces, not %u\n",
+                    path, want_version, version);
+            failed++;
+        }
+        else
+        {
+            uint32_t n = Compare(entries[i].name, entries[i].tolerance_ms, &want, &got);
+            printf("%-16s %u hit %u missed %u false, %s\n", entries[i].name,
+                   r.hits, r.misses, r.false_hits, n ? "FAILED" : "ok");
+            failed += (n != 0);
+        }
+        free(got.d);
+        free(want.d);
+    }
+    if (failed)
+    {
+        printf("%u of %d golden traces failed\n", failed, count);
+    }
+    return (failed ? 1 : 0);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int32_t ManifestRead(const char* dir, uint32_t* version, Entry* entries)
+{
+    char path[GOLDEN_PATH_LEN];
+    char line[256];
+    int32_t count = 0;
+    uint32_t n = 0;
+    FILE* fp = NULL;
+
+    snprintf(path, sizeof(path), "%s/MANIFEST", dir);
+    if (!(fp = fopen(path, "r")))
+    {
+        perror(path);
+        return (-1);
+    }
+    *version = 0;
+    while (fgets(line, sizeof(line), fp))
+    {
+        n++;
+        if (line[0] == '#' || strspn(line, " \t\r\n") == strlen(line))
+        {
+            continue;
+        }
+        if (sscanf(line, "version %u", version) == 1)
+        {
+            continue;
+        }
+        if (count == GOLDEN_MAX_TRACES ||
+            sscanf(line, "%127s %u", entries[count].name, &entries[count].tolerance_ms) != 2)
+        {
+            fprintf(stderr, "%s:%u: expected <trace> <tolerance ms>\n", path, n);
+            fclose(fp);
+            return (-1);
+        }
+        count++;
+    }
+    fclose(fp);
+    if (*version == 0)
+    {
+        fprintf(stderr, "%s: no version line\n", path);
+        return (-1);
+    }
+    return (count);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void Record(const ReplayDecision* d, void* ctx)
+{
+    Decisions* list = ctx;
+    if (list->count == list->capacity)
+    {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : 64;
+        ReplayDecision* grown = realloc(list->d, capacity * sizeof(ReplayDecision));
+        if (!grown)
+        {
+            return;
+        }
+        list->d = grown;
+        list->capacity = capacity;
+    }
+    list->d[list->count++] = *d;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void ExpectPath(char* path, const char* dir, const char* name,
+                const char* variant)
+{
+    const char* dot = strrchr(name, '.');
+    int len = dot ? (int)(dot - name) : (int)strlen(name);
+    if (variant)
+    {
+        snprintf(path, GOLDEN_PATH_LEN, "%s/%.*s.%s.expect", dir, len, name, variant);
+    }
+    else
+    {
+        snprintf(path, GOLDEN_PATH_LEN, "%s/%.*s.expect", dir, len, name);
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint8_t Same(const Decisions* a, const Decisions* b)
+{
+    uint32_t i = 0;
+    if (a->count != b->count)
+    {
+        return FALSE;
+    }
+    for (i = 0;i < a->count;i++)
+    {
+        const ReplayDecision* x = &a->d[i];
+        const ReplayDecision* y = &b->d[i];
+        if (x->outcome != y->outcome || x->ms != y->ms ||
+            (x->outcome != REPLAY_FALSE &&
+             (x->shot_start != y->shot_start || x->shot_end != y->shot_end)))
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t ExpectWrite(const char* path, uint32_t version, const Decisions* got)
+{
+    uint32_t i = 0;
+    FILE* fp = fopen(path, "w");
+    if (!fp)
+    {
+        return (FAILURE);
+    }
+    fprintf(fp, "# Written by regress -u, one decision per line:\n"
+                "#   HIT <ms> <shot start> <shot end>\n"
+                "#   MISS <shot start> <shot start> <shot end>\n"
+                "#   FALSE <ms>\n"
+                "version %u\n", version);
+    for (i = 0;i < got->count;i++)
+    {
+        const ReplayDecision* d = &got->d[i];
+        if (d->outcome == REPLAY_FALSE)
+        {
+            fprintf(fp, "%s %u\n", outcome_names[d->outcome], d->ms);
+        }
+        else
+        {
+            fprintf(fp, "%s %u %u %u\n", outcome_names[d->outcome],
+                    d->ms, d->shot_start, d->shot_end);
+        }
+    }
+    return ((ferror(fp) | fclose(fp)) ? FAILURE : SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t ExpectRead(const char* path, uint32_t* version, Decisions* want)
+{
+    char line[256];
+    char name[16];
+    uint32_t n = 0;
+    FILE* fp = fopen(path, "r");
+    if (!fp)
+    {
+        return (FAILURE);
+    }
+    while (fgets(line, sizeof(line), fp))
+    {
+        ReplayDecision d;
+        uint8_t o = 0;
+        n++;
+        if (line[0] == '#' || sscanf(line, "version %u", version) == 1)
+        {
+            continue;
+        }
+        memset(&d, 0, sizeof(d));
+        if (sscanf(line, "%15s %u %u %u", name, &d.ms, &d.shot_start, &d.shot_end) < 2)
+        {
+            continue;
+        }
+        for (o = 0;o < sizeof(outcome_names) / sizeof(outcome_names[0]);o++)
+        {
+            if (strcmp(name, outcome_names[o]) == 0)
+            {
+                break;
+            }
+        }
+        if (o == sizeof(outcome_names) / sizeof(outcome_names[0]))
+        {
+            fprintf(stderr, "%s:%u: unknown decision %s\n", path, n, name);
+            fclose(fp);
+            return (FAILURE);
+        }
+        d.outcome = o;
+        Record(&d, want);
+    }
+    fclose(fp);
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint32_t Compare(const char* name, uint32_t tolerance_ms,
+                 const Decisions* want, const Decisions* got)
+{
+    uint8_t* used = calloc(want->count + 1, 1);
+    uint32_t failed = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    for (i = 0;i < got->count;i++)
+    {
+        const ReplayDecision* d = &got->d[i];
+        const ReplayDecision* w = NULL;
+        if (d->outcome == REPLAY_FALSE)
+        {
+            // False hits have no shot to tie them to, so match them on time
+            for (j = 0;j < want->count;j++)
+            {
+                w = &want->d[j];
+                if (w->outcome == REPLAY_FALSE && !used[j] &&
+                    w->ms + tolerance_ms >= d->ms && d->ms + tolerance_ms >= w->ms)
+                {
+                    used[j] = TRUE;
+                    break;
+                }
+            }
+            if (j == want->count)
+            {
+                printf("  %s: new false hit at %u ms\n", name, d->ms);
+                failed++;
+            }
+            continue;
+        }
+        if (!(w = FindShot(want, d->shot_start)))
+        {
+            printf("  %s: shot at %u ms was not scored before\n", name, d->shot_start);
+            failed++;
+        }
+        else if (d->outcome == REPLAY_MISS && w->outcome == REPLAY_HIT)
+        {
+            printf("  %s: shot at %u ms was hit at %u ms, now missed\n",
+                   name, d->shot_start, w->ms);
+            failed++;
+        }
+        else if (d->outcome == REPLAY_HIT && w->outcome == REPLAY_MISS)
+        {
+            printf("  %s: better, shot at %u ms now hit at %u ms\n",
+                   name, d->shot_start, d->ms);
+        }
+        else if (d->outcome == REPLAY_HIT &&
+                 (d->ms > w->ms + tolerance_ms || w->ms > d->ms + tolerance_ms))
+        {
+            printf("  %s: shot at %u ms hit at %u ms, expected %u +-%u ms\n",
+                   name, d->shot_start, d->ms, w->ms, tolerance_ms);
+            failed++;
+        }
+    }
+
+    for (j = 0;j < want->count;j++)
+    {
+        const ReplayDecision* w = &want->d[j];
+        if (w->outcome == REPLAY_FALSE && !used[j])
+        {
+            printf("  %s: better, no false hit at %u ms\n", name, w->ms);
+        }
+        else if (w->outcome != REPLAY_FALSE && !FindShot(got, w->shot_start))
+        {
+            // Stunned or starting up where it used to be detecting
+            printf("  %s: shot at %u ms is no longer scored\n", name, w->shot_start);
+            failed++;
+        }
+    }
+    free(used);
+    return (failed);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+const ReplayDecision* FindShot(const Decisions* list, uint32_t shot_start)
+{
+    uint32_t i = 0;
+    for (i = 0;i < list->count;i++)
+    {
+        if (list->d[i].outcome != REPLAY_FALSE && list->d[i].shot_start == shot_start)
+        {
+            return (&list->d[i]);
+        }
+    }
+    return (NULL);
+}
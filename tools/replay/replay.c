@@ -0,0 +1,302 @@
+/**
+@file replay.c
+@brief Run recorded traces through the firmware hit detector
+@author Joe Brown
+*/
+#include "replay.h"
+#include "decimate.h"
+#include "fixed.h"
+
+/**
+@brief Settle the shots that can no longer be hit
+@details
+Reports a miss for each lane that neither hit nor was masked from each shot
+that ended more than the tolerance before now, and moves the first open shot
+past it.
+*/
+static void CloseShots(ReplayScore* score, uint32_t now);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void ReplayDefaults(ReplayConfig* cfg)
+{
+    cfg->period_ms    = 0;
+    cfg->stun_ms      = REPLAY_STUN_MS;
+    cfg->tolerance_ms = REPLAY_TOLERANCE_MS;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t ReplayRun(const Trace* trace, const ReplayConfig* cfg,
+                 ReplayResult* result, ReplayDecisionFn report, void* ctx)
+{
+    uint32_t listen_at = 0;
+    uint32_t next_sample = 0;
+    uint16_t red = 0;
+    uint16_t green = 0;
+    const TraceSample* t = NULL;
+    TraceCursor cursor;
+    ReplayScore score;
+
+    memset(result, 0, sizeof(*result));
+    if (ReplayAmbient(trace, &red, &green, &listen_at) != SUCCESS)
+    {
+        return (FAILURE);
+    }
+    DetectReset();
+    DetectInit(red, green);
+#ifdef DETECT_DECIMATE
+    DecimateReset();
+#endif
+    result->duration_ms = trace->last_ms - trace->first_ms;
+    listen_at += REPLAY_STARTUP_MS;
+    next_sample = listen_at;
+
+    ReplayScoreBegin(&score, cfg, result, 1, report, ctx);
+    TraceBegin(trace, &cursor);
+    while ((t = TraceNext(&cursor)) != NULL)
+    {
+        uint8_t listening = (t->ms >= listen_at);
+        ColorReading color;
+
+        if (ReplayScoreSample(&score, t, listening) != SUCCESS)
+        {
+            ReplayScoreEnd(&score);
+            return (FAILURE);
+        }
+        if (!listening || t->ms < next_sample)
+        {
+            continue;
+        }
+        next_sample = t->ms + cfg->period_ms;
+
+        // CheckForHit
+        color.red   = t->red;
+        color.green = t->green;
+#ifdef DETECT_READ_ALL_COLORS
+        color.blue  = t->blue;
+        color.clear = t->clear;
+#else
+        color.blue  = 0;
+        color.clear = 0;
+#endif
+#ifdef DETECT_DECIMATE
+        if (!DecimateSample(&color))
+        {
+            continue;
+        }
+#endif
+        result->samples++;
+        if (DetectSample(&color, REPLAY_TICKS(t->ms)))
+        {
+            ReplayScoreHit(&score, 0, t->ms, DetectLastHit());
+            // Stunned
+            listen_at = t->ms + cfg->stun_ms;
+            next_sample = listen_at;
+#ifdef DETECT_DECIMATE
+            DecimateReset();
+#endif
+        }
+    }
+    ReplayScoreEnd(&score);
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void ReplayAccumulate(ReplayResult* total, const ReplayResult* result)
+{
+    total->samples     += result->samples;
+    total->duration_ms += result->duration_ms;
+    total->shots       += result->shots;
+    total->masked      += result->masked;
+    total->hits        += result->hits;
+    total->misses      += result->misses;
+    total->false_hits  += result->false_hits;
+    total->latency_sum += result->latency_sum;
+    if (result->latency_max > total->latency_max)
+    {
+        total->latency_max = result->latency_max;
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t ReplayAmbient(const Trace* trace, uint16_t* red, uint16_t* green,
+                     uint32_t* done_ms)
+{
+    uint32_t due = trace->first_ms + REPLAY_SETTLE_MS;
+    uint32_t taken = 0;
+    uint32_t red_sum = 0;
+    uint32_t green_sum = 0;
+    const TraceSample* t = NULL;
+    TraceCursor cursor;
+    TraceBegin(trace, &cursor);
+    while ((t = TraceNext(&cursor)) != NULL)
+    {
+        if (t->ms < due)
+        {
+            continue;
+        }
+        red_sum = FixedAccumulate(red_sum, t->red);
+        green_sum = FixedAccumulate(green_sum, t->green);
+        due = t->ms + CALIBRATE_PERIOD_MS;
+        if (++taken == _BV(CALIBRATE_SAMPLES_SHIFT))
+        {
+            *red = FIXED_MEAN(red_sum, CALIBRATE_SAMPLES_SHIFT);
+            *green = FIXED_MEAN(green_sum, CALIBRATE_SAMPLES_SHIFT);
+            *done_ms = t->ms;
+            return (SUCCESS);
+        }
+    }
+    return (FAILURE);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                 Scoring
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void ReplayScoreBegin(ReplayScore* score, const ReplayConfig* cfg,
+                      ReplayResult* results, uint8_t lanes,
+                      ReplayDecisionFn report, void* ctx)
+{
+    memset(score, 0, sizeof(*score));
+    score->cfg     = cfg;
+    score->results = results;
+    score->lanes   = lanes;
+    score->report  = report;
+    score->ctx     = ctx;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t ReplayScoreSample(ReplayScore* score, const TraceSample* t, uint32_t listening)
+{
+    uint8_t lane = 0;
+    if (t->truth && !score->was_on)
+    {
+        ReplayShot* shot = NULL;
+        if (score->count == score->capacity)
+        {
+            uint32_t capacity = score->capacity ? score->capacity * 2 : 64;
+            ReplayShot* grown = realloc(score->shots, capacity * sizeof(ReplayShot));
+            if (!grown)
+            {
+                return (FAILURE);
+            }
+            score->shots = grown;
+            score->capacity = capacity;
+        }
+        shot = &score->shots[score->count++];
+        memset(shot, 0, sizeof(*shot));
+        shot->start = t->ms;
+        for (lane = 0;lane < score->lanes;lane++)
+        {
+            if (listening & _BV(lane))
+            {
+                score->results[lane].shots++;
+            }
+            else
+            {
+                shot->masked |= (uint32_t)1 << lane;
+                score->results[lane].masked++;
+            }
+        }
+    }
+    if (t->truth)
+    {
+        score->shots[score->count - 1].end = t->ms;
+    }
+    score->was_on = t->truth;
+    CloseShots(score, t->ms);
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void ReplayScoreHit(ReplayScore* score, uint8_t lane, uint32_t ms, const DetectHit* hit)
+{
+    ReplayResult* result = &score->results[lane];
+    uint32_t bit = (uint32_t)1 << lane;
+    uint32_t s = score->open;
+    ReplayDecision d;
+
+    memset(&d, 0, sizeof(d));
+    d.lane = lane;
+    d.ms = ms;
+    if (hit)
+    {
+        d.hit = *hit;
+    }
+    while (s < score->count && score->shots[s].start <= ms &&
+           ((score->shots[s].matched & bit) ||
+            ms > score->shots[s].end + score->cfg->tolerance_ms))
+    {
+        s++;
+    }
+    if (s < score->count && score->shots[s].start <= ms)
+    {
+        ReplayShot* shot = &score->shots[s];
+        // A shot that began while we were blind still counts once the target
+        // comes back in time to see it
+        if (shot->masked & bit)
+        {
+            shot->masked &= ~bit;
+            result->masked--;
+            result->shots++;
+        }
+        shot->matched |= bit;
+        d.outcome = REPLAY_HIT;
+        d.shot_start = shot->start;
+        d.shot_end = shot->end;
+        result->hits++;
+        result->latency_sum += ms - shot->start;
+        if (ms - shot->start > result->latency_max)
+        {
+            result->latency_max = ms - shot->start;
+        }
+    }
+    else
+    {
+        d.outcome = REPLAY_FALSE;
+        result->false_hits++;
+    }
+    if (score->report)
+    {
+        score->report(&d, score->ctx);
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void ReplayScoreEnd(ReplayScore* score)
+{
+    CloseShots(score, 0xFFFFFFFF);
+    free(score->shots);
+    score->shots = NULL;
+    score->count = 0;
+    score->capacity = 0;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void CloseShots(ReplayScore* score, uint32_t now)
+{
+    uint8_t lane = 0;
+    while (score->open < score->count &&
+           now > score->shots[score->open].end + score->cfg->tolerance_ms)
+    {
+        ReplayShot* shot = &score->shots[score->open];
+        for (lane = 0;lane < score->lanes;lane++)
+        {
+            if ((shot->matched | shot->masked) & ((uint32_t)1 << lane))
+            {
+                continue;
+            }
+            score->results[lane].misses++;
+            if (score->report)
+            {
+                ReplayDecision d;
+                memset(&d, 0, sizeof(d));
+                d.outcome = REPLAY_MISS;
+                d.lane = lane;
+                d.ms = shot->start;
+                d.shot_start = shot->start;
+                d.shot_end = shot->end;
+                score->report(&d, score->ctx);
+            }
+        }
+        score->open++;
+    }
+}
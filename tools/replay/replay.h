@@ -0,0 +1,200 @@
+/**
+@file replay.h
+@brief Run recorded traces through the firmware hit detector
+@author Joe Brown
+*/
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "global.h"
+#include "detect.h"
+#include "schedule.h"
+#include "trace.h"
+
+// main waits this long after power up before RecordAmbientLight starts
+#define REPLAY_SETTLE_MS        500
+// and this long after it finishes before the target starts detecting
+#define REPLAY_STARTUP_MS       1000
+// Stunned holds for a second and BroadcastReset takes two 150ms delays
+#define REPLAY_STUN_MS          1300
+// Time between the samples the detector sees
+#define REPLAY_CHECK_MS         DETECT_PERIOD_MS
+// An accepted hit is reported on the first sample after the laser goes off, so
+// allow a little over one CheckForHit period after the end of a labeled shot.
+// Pulse coded lasers are only off once the whole gap has gone by, and a
+// dropout is only an end once DETECT_DROPOUT_SAMPLES have gone by.
+#ifdef DETECT_PULSE_CODE
+#define REPLAY_TOLERANCE_MS     ((PULSE_GAP_SAMPLES + DETECT_DROPOUT_SAMPLES + 1) * REPLAY_CHECK_MS)
+#else
+#define REPLAY_TOLERANCE_MS     ((DETECT_DROPOUT_SAMPLES + 2) * REPLAY_CHECK_MS)
+#endif
+
+// The scheduler ticks every SCHEDULE_TICK_US, see ScheduleTimerInit
+#define REPLAY_TICKS(ms)        ((uint32_t)((uint64_t)(ms) * SCHEDULE_TICKS(1000) / 1000))
+
+/** @brief How the target is driven through a trace */
+typedef struct
+{
+    uint32_t period_ms;     /**< CheckForHit period, 0 to take every sample */
+    uint32_t stun_ms;       /**< time the target stops detecting after a hit */
+    uint32_t tolerance_ms;  /**< how late after a shot its hit may be reported */
+} ReplayConfig;
+
+enum ReplayOutcome
+{
+    REPLAY_HIT,     /**< detector hit matched to a labeled shot */
+    REPLAY_FALSE,   /**< detector hit with no labeled shot */
+    REPLAY_MISS     /**< labeled shot with no detector hit */
+};
+
+/** @brief One decision, passed to the ReplayDecisionFn as it is made */
+typedef struct
+{
+    uint8_t   outcome;      /**< enum ReplayOutcome */
+    uint8_t   lane;         /**< which run of a ReplayScore made it */
+    uint32_t  ms;           /**< time of the hit, or shot start for a miss */
+    uint32_t  shot_start;   /**< labeled shot, unused for REPLAY_FALSE */
+    uint32_t  shot_end;
+    DetectHit hit;          /**< detector details, unused for REPLAY_MISS */
+} ReplayDecision;
+
+/** @brief function pointer told about each decision */
+typedef void (*ReplayDecisionFn)(const ReplayDecision* decision, void* ctx);
+
+/** @brief Totals for one or more traces */
+typedef struct
+{
+    uint32_t samples;       /**< samples run through the detector */
+    uint64_t duration_ms;   /**< recording time covered */
+    uint32_t shots;         /**< labeled shots while the target was detecting */
+    uint32_t masked;        /**< labeled shots while it was starting or stunned */
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t false_hits;
+    uint64_t latency_sum;   /**< shot start to hit, summed over hits */
+    uint32_t latency_max;
+} ReplayResult;
+
+/** @brief A labeled shot, a run of samples with truth set */
+typedef struct
+{
+    uint32_t start;
+    uint32_t end;
+    uint32_t matched;   /**< lanes that have hit it */
+    uint32_t masked;    /**< lanes that were not detecting when it started */
+} ReplayShot;
+
+/** @brief Scores up to 32 runs over the same trace against its labeled shots
+at once. The shots are found as the samples go by, so the trace is only read
+the once.*/
+typedef struct
+{
+    const ReplayConfig* cfg;
+    ReplayResult*       results;    /**< one per lane */
+    uint8_t             lanes;
+    ReplayDecisionFn    report;
+    void*               ctx;
+    ReplayShot*         shots;
+    uint32_t            count;
+    uint32_t            capacity;
+    uint32_t            open;       /**< first shot that may still be hit */
+    uint8_t             was_on;
+} ReplayScore;
+
+/**
+@brief Fill in the timing the firmware uses
+@param[out] cfg configuration to fill
+*/
+extern void ReplayDefaults(ReplayConfig* cfg);
+
+/**
+@brief Run one trace through the detector
+@details
+Does what main does with the samples instead of the sensor. The first
+2^CALIBRATE_SAMPLES_SHIFT samples CALIBRATE_PERIOD_MS apart after
+REPLAY_SETTLE_MS seed the detector as RecordAmbientLight would, then every
+sample at least period_ms after the previous one goes to DetectSample the way
+CheckForHit sends it, timed in scheduler ticks. With DETECT_DECIMATE those are
+sensor reads and go through DecimateSample first. After each hit the target is
+blind for stun_ms. Kills are not modelled, the target always comes back.
+
+Each hit is matched to the earliest unmatched labeled shot it falls within (up
+to tolerance_ms after the shot ends). Shots that start while the target is not
+detecting are counted as masked rather than missed.
+@param[in] trace recording to run
+@param[in] cfg timing to run it with
+@param[out] result totals for this trace, cleared first
+@param[in] report told about every decision in time order, may be NULL
+@param[in] ctx passed through to report
+@return SUCCESS, or FAILURE if the trace is too short to calibrate
+*/
+extern int8_t ReplayRun(const Trace* trace, const ReplayConfig* cfg,
+                        ReplayResult* result, ReplayDecisionFn report, void* ctx);
+
+/**
+@brief Average the ambient light at the start of a trace
+@details
+Takes the first 2^CALIBRATE_SAMPLES_SHIFT samples CALIBRATE_PERIOD_MS apart
+after REPLAY_SETTLE_MS, the way RecordAmbientLight does.
+@param[in] trace recording to read
+@param[out] red average red
+@param[out] green average green
+@param[out] done_ms time of the last sample taken
+@return SUCCESS, or FAILURE if the trace is too short
+*/
+extern int8_t ReplayAmbient(const Trace* trace, uint16_t* red, uint16_t* green,
+                            uint32_t* done_ms);
+
+/**
+@brief Start scoring runs over a trace
+@param[out] score scorer to set up
+@param[in] cfg timing the runs use, for the tolerance
+@param[in,out] results one per lane, added to
+@param[in] lanes number of runs, 1 to 32
+@param[in] report told about every decision in time order, may be NULL
+@param[in] ctx passed through to report
+*/
+extern void ReplayScoreBegin(ReplayScore* score, const ReplayConfig* cfg,
+                             ReplayResult* results, uint8_t lanes,
+                             ReplayDecisionFn report, void* ctx);
+
+/**
+@brief Account for the next sample of the trace
+@details
+Call for every sample, in order, before any hit on it is scored. Settles the
+shots that are now too old to be hit.
+@param[in] score scorer
+@param[in] t the sample
+@param[in] listening bit per lane, set if that run was detecting
+@return SUCCESS, or FAILURE when out of memory
+*/
+extern int8_t ReplayScoreSample(ReplayScore* score, const TraceSample* t,
+                                uint32_t listening);
+
+/**
+@brief Score a hit from one run
+@details
+The hit is matched to the earliest shot that run has not hit yet which it
+falls within, up to the tolerance after the shot ends. Otherwise it is false.
+@param[in] score scorer
+@param[in] lane run that hit
+@param[in] ms time of the hit
+@param[in] hit detector details, may be NULL
+*/
+extern void ReplayScoreHit(ReplayScore* score, uint8_t lane, uint32_t ms,
+                           const DetectHit* hit);
+
+/**
+@brief Settle the remaining shots and release the scorer
+@param[in] score scorer
+*/
+extern void ReplayScoreEnd(ReplayScore* score);
+
+/**
+@brief Add the totals of one run into another
+@param[in,out] total running totals
+@param[in] result totals to add
+*/
+extern void ReplayAccumulate(ReplayResult* total, const ReplayResult* result);
+
+#endif // REPLAY_H
@@ -0,0 +1,192 @@
+/**
+@file stress.c
+@brief Push synthetic traces through the hit detector at scale
+@author Joe Brown
+@details
+    stress [-n traces] [-s seed] [-w prefix] [-v] [-l] [preset|setting=value ...]
+
+Synthesizes traces from the model in synth.h, trace i from seed + i, runs
+each through the detector the way replay does and reports the hit rate, false
+hits per hour and the spread of hit latency over all of them. Presets and
+settings apply in order on top of the defaults, -l lists them. -w also writes
+every trace as <prefix><seed>.txt so a bad one can be looked at with replay
+-v, and -v prints the result for each trace.
+*/
+#include <time.h>
+#include <unistd.h>
+#include "replay.h"
+#include "synth.h"
+
+#define STRESS_BIN_MS       10
+#define STRESS_BINS         1000
+
+/** @brief Totals and the latency histogram over every trace */
+typedef struct
+{
+    ReplayResult total;
+    uint32_t     latency[STRESS_BINS + 1];  /**< last bin is everything later */
+} Stats;
+
+/**
+@brief ReplayDecisionFn that adds hit latencies to the histogram
+*/
+static void Record(const ReplayDecision* d, void* ctx);
+
+/**
+@brief Latency below which a fraction of the hits came in
+*/
+static uint32_t Percentile(const Stats* stats, double fraction);
+
+/**
+@brief Seconds since some fixed point
+*/
+static double Now(void);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Entry
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int main(int argc, char** argv)
+{
+    static Stats stats;
+    const char* prefix = NULL;
+    unsigned long long seed = 1;
+    uint32_t traces = 100;
+    uint32_t failed = 0;
+    uint32_t i = 0;
+    uint64_t samples = 0;
+    double synth_s = 0;
+    double replay_s = 0;
+    uint8_t verbose = FALSE;
+    uint8_t list = FALSE;
+    ReplayConfig cfg;
+    ReplayResult* t = &stats.total;
+    SynthModel model;
+    int opt = 0;
+
+    SynthDefaults(&model);
+    ReplayDefaults(&cfg);
+    while ((opt = getopt(argc, argv, "n:s:w:vl")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': traces = strtoul(optarg, NULL, 0); break;
+            case 's': seed = strtoull(optarg, NULL, 0); break;
+            case 'w': prefix = optarg; break;
+            case 'v': verbose = TRUE; break;
+            case 'l': list = TRUE; break;
+            default:
+                fprintf(stderr, "usage: %s [-n traces] [-s seed] [-w prefix] [-v] [-l] "
+                        "[preset|setting=value ...]\n", argv[0]);
+                return (2);
+        }
+    }
+    for (;optind < argc;optind++)
+    {
+        if (SynthSet(&model, argv[optind]) != SUCCESS)
+        {
+            return (2);
+        }
+    }
+    if (list)
+    {
+        SynthPrint(stdout, &model);
+        return (0);
+    }
+
+    for (i = 0;i < traces;i++)
+    {
+        Trace trace;
+        ReplayResult r;
+        double start = Now();
+        if (SynthTrace(&model, seed + i, &trace) != SUCCESS)
+        {
+            fprintf(stderr, "%s: out of memory\n", argv[0]);
+            return (1);
+        }
+        synth_s += Now() - start;
+        samples += trace.count;
+        if (prefix)
+        {
+            char path[512];
+            snprintf(path, sizeof(path), "%s%llu.txt", prefix, seed + i);
+            if (SynthWrite(&trace, path) != SUCCESS)
+            {
+                perror(path);
+                return (1);
+            }
+        }
+
+        start = Now();
+        if (ReplayRun(&trace, &cfg, &r, Record, &stats) != SUCCESS)
+        {
+            fprintf(stderr, "%s: too short to calibrate\n", trace.name);
+            failed++;
+        }
+        else
+        {
+            ReplayAccumulate(t, &r);
+            if (verbose)
+            {
+                printf("%s: %u shots (%u masked), %u hit, %u missed, %u false\n",
+                       trace.name, r.shots, r.masked, r.hits, r.misses, r.false_hits);
+            }
+        }
+        replay_s += Now() - start;
+        SynthFree(&trace);
+    }
+
+    printf("%u traces from seed %llu, %.1f h\n", traces - failed, seed,
+           t->duration_ms / 3600000.0);
+    printf("shots %u (%u masked), %u hit (%.1f%%), %u missed\n", t->shots,
+           t->masked, t->hits, t->shots ? 100.0 * t->hits / t->shots : 0.0, t->misses);
+    printf("false hits %u (%.2f per hour)\n", t->false_hits,
+           t->duration_ms ? t->false_hits * 3600000.0 / t->duration_ms : 0.0);
+    if (t->hits)
+    {
+        printf("latency ms: mean %u p50 %u p95 %u p99 %u max %u\n",
+               (uint32_t)(t->latency_sum / t->hits), Percentile(&stats, 0.50),
+               Percentile(&stats, 0.95), Percentile(&stats, 0.99), t->latency_max);
+    }
+    printf("synthesized %.1fM samples in %.2f s, replayed in %.2f s (%.0fx real time)\n",
+           samples / 1e6, synth_s, replay_s,
+           replay_s > 0 ? t->duration_ms / 1000.0 / replay_s : 0);
+    return (failed ? 1 : 0);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void Record(const ReplayDecision* d, void* ctx)
+{
+    Stats* stats = ctx;
+    uint32_t bin = 0;
+    if (d->outcome != REPLAY_HIT)
+    {
+        return;
+    }
+    bin = (d->ms - d->shot_start) / STRESS_BIN_MS;
+    stats->latency[(bin < STRESS_BINS) ? bin : STRESS_BINS]++;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint32_t Percentile(const Stats* stats, double fraction)
+{
+    uint64_t want = (uint64_t)(stats->total.hits * fraction + 0.5);
+    uint64_t seen = 0;
+    uint32_t bin = 0;
+    for (bin = 0;bin < STRESS_BINS;bin++)
+    {
+        seen += stats->latency[bin];
+        if (seen >= want)
+        {
+            break;
+        }
+    }
+    return (bin * STRESS_BIN_MS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,567 @@
+/**
+@file sweep.c
+@brief Run a labeled trace corpus through a grid of detector settings
+@author Joe Brown
+@details
+    sweep [-j jobs] [-k kernel] [-o prefix] [-T target] [-S session]
+          -p name=lo:hi[:step] ... trace...
+
+Every combination of the -p ranges is replayed over every trace, spread over
+jobs worker processes (one per core by default). Settings that are not swept
+keep their config.h values. -k picks what runs the detector: firmware is
+detect.c itself, one combination at a time, while scalar and avx2 are the batch
+kernels in batch.c that run eight combinations per pass over a trace. The
+default is avx2 when the detector and the CPU allow it, firmware otherwise.
+Writes three CSV files:
+
+    <prefix>_grid.csv    every combination with its hit and false hit rates
+    <prefix>_roc.csv     the combinations no other one beats on both rates,
+                         in order of false hits, which traces the ROC curve
+    <prefix>_params.csv  hit and false hit rates pooled over each value of
+                         each swept setting
+
+The hit rate is hits over labeled shots the target was detecting for. There is
+no fixed count of negatives in a recording so false hits are given per hour.
+*/
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "replay.h"
+#include "tune.h"
+#include "batch.h"
+
+#define SWEEP_MAX_AXES      8
+#define SWEEP_MAX_POINTS    10000000
+
+/** @brief A setting that can be swept */
+typedef struct
+{
+    const char* name;
+    size_t      offset;     /**< of the uint32_t in TunePoint */
+} Param;
+
+static const Param params[] =
+{
+    {"hit_min",      offsetof(TunePoint, tune.hit_min_ms)},
+    {"hit_max",      offsetof(TunePoint, tune.hit_max_ms)},
+    {"red_margin",   offsetof(TunePoint, tune.red_margin)},
+    {"green_margin", offsetof(TunePoint, tune.green_margin)},
+    {"clear_margin", offsetof(TunePoint, tune.clear_margin)},
+    {"red_gain",     offsetof(TunePoint, tune.red_gain)},
+    {"green_gain",   offsetof(TunePoint, tune.green_gain)},
+    {"clear_gain",   offsetof(TunePoint, tune.clear_gain)},
+    {"rise",         offsetof(TunePoint, tune.rise_shift)},
+    {"fall",         offsetof(TunePoint, tune.fall_shift)},
+    {"period",       offsetof(TunePoint, period_ms)}
+};
+#define NUM_PARAMS (sizeof(params) / sizeof(params[0]))
+
+/** @brief One swept setting, lo to hi inclusive */
+typedef struct
+{
+    const Param* param;
+    uint32_t     lo;
+    uint32_t     step;
+    uint32_t     count;
+} Axis;
+
+/** @brief What runs the detector */
+enum SweepKernel
+{
+    SWEEP_FIRMWARE,
+    SWEEP_SCALAR,
+    SWEEP_AVX2
+};
+
+static const char* const kernel_names[] = {"firmware", "scalar", "avx2"};
+
+/** @brief What a worker sends back for each combination */
+typedef struct
+{
+    uint32_t     index;
+    ReplayResult result;
+} Record;
+
+static Axis     axes[SWEEP_MAX_AXES];
+static uint8_t  axis_cnt = 0;
+static uint32_t point_cnt = 1;
+static uint8_t  kernel = SWEEP_FIRMWARE;
+static TraceSet corpus;
+
+/**
+@brief Parse a name=lo:hi[:step] range into the next axis
+@return SUCCESS or FAILURE
+*/
+static int8_t AxisParse(const char* arg);
+
+/**
+@brief Value an axis takes in a combination
+*/
+static uint32_t AxisValue(const Axis* axis, uint32_t index);
+
+/**
+@brief Fill in the settings for a combination
+*/
+static void PointGet(uint32_t index, TunePoint* p);
+
+/**
+@brief Pick the detector from a -k argument
+@return SUCCESS or FAILURE
+*/
+static int8_t KernelParse(const char* arg);
+
+/**
+@brief Replay the whole corpus for every jobs'th group of combinations
+@details
+A group is one combination for the firmware kernel and BATCH_LANES for the
+batch kernels.
+@param[in] first group to start at
+@param[in] jobs stride between groups
+@param[in] fd where to write a Record for each combination
+*/
+static void Worker(uint32_t first, uint32_t jobs, int fd);
+
+/**
+@brief Hit rate and false hits per hour of a result
+*/
+static void Rates(const ReplayResult* r, double* hit_rate, double* false_rate);
+
+/**
+@brief Write the three CSV files
+@return SUCCESS or FAILURE
+*/
+static int8_t WriteReports(const char* prefix, const ReplayResult* results);
+
+/**
+@brief Write the swept settings of a combination as CSV fields
+*/
+static void PrintPoint(FILE* fp, uint32_t index);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Entry
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int main(int argc, char** argv)
+{
+    const char* prefix = "sweep";
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    ReplayResult* results = NULL;
+    uint8_t* seen = NULL;
+    struct timespec t0, t1;
+    uint32_t received = 0;
+    uint32_t groups = 0;
+    Record rec;
+    int fds[2];
+    int opt = 0;
+    int status = 0;
+    int ret = 0;
+    long w = 0;
+
+    TraceSetInit(&corpus);
+    if (BatchSupported() && BatchAvx2())
+    {
+        kernel = SWEEP_AVX2;
+    }
+    while ((opt = getopt(argc, argv, "j:k:o:p:T:S:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'j': jobs = strtol(optarg, NULL, 0); break;
+            case 'k':
+                if (KernelParse(optarg) != SUCCESS)
+                {
+                    return (2);
+                }
+                break;
+            case 'o': prefix = optarg; break;
+            case 'T': corpus.target = strtol(optarg, NULL, 0); break;
+            case 'S': corpus.session = strtol(optarg, NULL, 0); break;
+            case 'p':
+                if (AxisParse(optarg) != SUCCESS)
+                {
+                    return (2);
+                }
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-j jobs] [-k kernel] [-o prefix] [-T target] "
+                        "[-S session] -p name=lo:hi[:step] ... trace...\n", argv[0]);
+                return (2);
+        }
+    }
+    if (optind == argc || axis_cnt == 0)
+    {
+        fprintf(stderr, "%s: need at least one -p range and one trace\n", argv[0]);
+        return (2);
+    }
+    if (jobs < 1)
+    {
+        jobs = 1;
+    }
+    groups = (kernel == SWEEP_FIRMWARE) ? point_cnt :
+             (point_cnt + BATCH_LANES - 1) / BATCH_LANES;
+    if ((uint32_t)jobs > groups)
+    {
+        jobs = groups;
+    }
+
+    // Load the corpus once, the workers share it copy on write
+    results = calloc(point_cnt, sizeof(ReplayResult));
+    seen = calloc(point_cnt, 1);
+    if (!results || !seen)
+    {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return (1);
+    }
+    for (;optind < argc;optind++)
+    {
+        if (TraceSetAdd(&corpus, argv[optind]) != SUCCESS)
+        {
+            return (1);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (pipe(fds) != 0)
+    {
+        perror("pipe");
+        return (1);
+    }
+    for (w = 0;w < jobs;w++)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            perror("fork");
+            return (1);
+        }
+        if (pid == 0)
+        {
+            close(fds[0]);
+            Worker(w, jobs, fds[1]);
+            _exit(0);
+        }
+    }
+    close(fds[1]);
+
+    // A group of Records is smaller than PIPE_BUF so each write arrives whole
+    while (read(fds[0], &rec, sizeof(rec)) == sizeof(rec))
+    {
+        if (rec.index < point_cnt && !seen[rec.index])
+        {
+            seen[rec.index] = TRUE;
+            results[rec.index] = rec.result;
+            received++;
+        }
+    }
+    close(fds[0]);
+    while (wait(&status) > 0)
+    {
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            ret = 1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (received != point_cnt)
+    {
+        fprintf(stderr, "%s: only %u of %u combinations came back\n",
+                argv[0], received, point_cnt);
+        return (1);
+    }
+
+    if (WriteReports(prefix, results) != SUCCESS)
+    {
+        ret = 1;
+    }
+    printf("%u combinations x %u traces on %ld %s jobs in %.2f s\n",
+           point_cnt, corpus.count, jobs, kernel_names[kernel],
+           (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+    TraceSetFree(&corpus);
+    return (ret);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t AxisParse(const char* arg)
+{
+    const char* eq = strchr(arg, '=');
+    unsigned long lo = 0, hi = 0, step = 1;
+    uint8_t i = 0;
+    int n = 0;
+    if (axis_cnt == SWEEP_MAX_AXES)
+    {
+        fprintf(stderr, "at most %u swept settings\n", SWEEP_MAX_AXES);
+        return (FAILURE);
+    }
+    for (i = 0;eq && i < NUM_PARAMS;i++)
+    {
+        if (strlen(params[i].name) == (size_t)(eq - arg) &&
+            strncmp(params[i].name, arg, eq - arg) == 0)
+        {
+            break;
+        }
+    }
+    if (!eq || i == NUM_PARAMS)
+    {
+        fprintf(stderr, "%s: unknown setting, one of:", arg);
+        for (i = 0;i < NUM_PARAMS;i++)
+        {
+            fprintf(stderr, " %s", params[i].name);
+        }
+        fprintf(stderr, "\n");
+        return (FAILURE);
+    }
+    n = sscanf(eq + 1, "%lu:%lu:%lu", &lo, &hi, &step);
+    if (n < 2 || hi < lo || step == 0)
+    {
+        fprintf(stderr, "%s: expected %s=lo:hi[:step]\n", arg, params[i].name);
+        return (FAILURE);
+    }
+    axes[axis_cnt].param = &params[i];
+    axes[axis_cnt].lo    = lo;
+    axes[axis_cnt].step  = step;
+    axes[axis_cnt].count = (hi - lo) / step + 1;
+    if ((uint64_t)point_cnt * axes[axis_cnt].count > SWEEP_MAX_POINTS)
+    {
+        fprintf(stderr, "%s: more than %u combinations\n", arg, SWEEP_MAX_POINTS);
+        return (FAILURE);
+    }
+    point_cnt *= axes[axis_cnt].count;
+    axis_cnt++;
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint32_t AxisValue(const Axis* axis, uint32_t index)
+{
+    // The first axis varies slowest
+    uint8_t i = 0;
+    for (i = axis - axes + 1;i < axis_cnt;i++)
+    {
+        index /= axes[i].count;
+    }
+    return axis->lo + (index % axis->count) * axis->step;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void PointGet(uint32_t index, TunePoint* p)
+{
+    uint8_t i = 0;
+    TuneDefaults();
+    p->tune = g_tune;
+    p->period_ms = 0;
+    for (i = 0;i < axis_cnt;i++)
+    {
+        *(uint32_t*)((uint8_t*)p + axes[i].param->offset) = AxisValue(&axes[i], index);
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t KernelParse(const char* arg)
+{
+    uint8_t k = 0;
+    for (k = 0;k < sizeof(kernel_names) / sizeof(kernel_names[0]);k++)
+    {
+        if (strcmp(arg, kernel_names[k]) == 0)
+        {
+            break;
+        }
+    }
+    if (k == sizeof(kernel_names) / sizeof(kernel_names[0]))
+    {
+        fprintf(stderr, "%s: unknown kernel, one of: firmware scalar avx2\n", arg);
+        return (FAILURE);
+    }
+    if (k != SWEEP_FIRMWARE && !BatchSupported())
+    {
+        fprintf(stderr, "%s: the batch kernels only run the THRESHOLD detector "
+                        "without pulse codes or flash rejection\n", arg);
+        return (FAILURE);
+    }
+    if (k == SWEEP_AVX2 && !BatchAvx2())
+    {
+        fprintf(stderr, "%s: not supported on this CPU\n", arg);
+        return (FAILURE);
+    }
+    kernel = k;
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void Worker(uint32_t first, uint32_t jobs, int fd)
+{
+    uint32_t size = (kernel == SWEEP_FIRMWARE) ? 1 : BATCH_LANES;
+    uint32_t g = 0;
+    uint32_t t = 0;
+    uint8_t count = 0;
+    uint8_t i = 0;
+    ReplayConfig cfg;
+    Record rec[BATCH_LANES];
+    TunePoint p[BATCH_LANES];
+    ReplayResult r[BATCH_LANES];
+
+    ReplayDefaults(&cfg);
+    for (g = first * size;g < point_cnt;g += jobs * size)
+    {
+        count = (point_cnt - g < size) ? point_cnt - g : size;
+        memset(rec, 0, sizeof(rec));
+        for (i = 0;i < count;i++)
+        {
+            PointGet(g + i, &p[i]);
+            rec[i].index = g + i;
+        }
+        for (t = 0;t < corpus.count;t++)
+        {
+            int8_t ok = FAILURE;
+            if (kernel == SWEEP_FIRMWARE)
+            {
+                g_tune = p[0].tune;
+                cfg.period_ms = p[0].period_ms;
+                ok = ReplayRun(&corpus.traces[t], &cfg, &r[0], NULL, NULL);
+            }
+            else
+            {
+                ok = BatchRun(&corpus.traces[t], &cfg, p, count, r,
+                              (kernel == SWEEP_AVX2) ? BATCH_KERNEL_AVX2 : BATCH_KERNEL_SCALAR,
+                              NULL, NULL);
+            }
+            for (i = 0;ok == SUCCESS && i < count;i++)
+            {
+                ReplayAccumulate(&rec[i].result, &r[i]);
+            }
+        }
+        if (write(fd, rec, count * sizeof(Record)) != (ssize_t)(count * sizeof(Record)))
+        {
+            _exit(1);
+        }
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void Rates(const ReplayResult* r, double* hit_rate, double* false_rate)
+{
+    *hit_rate = r->shots ? (double)r->hits / r->shots : 0;
+    *false_rate = r->duration_ms ? r->false_hits * 3600000.0 / r->duration_ms : 0;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void PrintPoint(FILE* fp, uint32_t index)
+{
+    uint8_t i = 0;
+    for (i = 0;i < axis_cnt;i++)
+    {
+        fprintf(fp, "%u,", AxisValue(&axes[i], index));
+    }
+}
+
+/** @brief qsort order for the ROC, fewest false hits first then most hits */
+static const ReplayResult* sort_results;
+static int RocOrder(const void* a, const void* b)
+{
+    double ha, fa, hb, fb;
+    Rates(&sort_results[*(const uint32_t*)a], &ha, &fa);
+    Rates(&sort_results[*(const uint32_t*)b], &hb, &fb);
+    if (fa != fb)
+    {
+        return (fa < fb) ? -1 : 1;
+    }
+    return (ha > hb) ? -1 : (ha < hb);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t WriteReports(const char* prefix, const ReplayResult* results)
+{
+    char path[512];
+    uint32_t* order = NULL;
+    FILE* fp = NULL;
+    double hit_rate, false_rate, best = -1;
+    uint32_t i = 0;
+    uint8_t a = 0;
+
+    // Every combination
+    snprintf(path, sizeof(path), "%s_grid.csv", prefix);
+    if (!(fp = fopen(path, "w")))
+    {
+        perror(path);
+        return (FAILURE);
+    }
+    for (a = 0;a < axis_cnt;a++)
+    {
+        fprintf(fp, "%s,", axes[a].param->name);
+    }
+    fprintf(fp, "shots,hits,misses,false_hits,hit_rate,false_per_hour,latency_mean_ms\n");
+    for (i = 0;i < point_cnt;i++)
+    {
+        const ReplayResult* r = &results[i];
+        Rates(r, &hit_rate, &false_rate);
+        PrintPoint(fp, i);
+        fprintf(fp, "%u,%u,%u,%u,%.4f,%.3f,%.0f\n", r->shots, r->hits, r->misses,
+                r->false_hits, hit_rate, false_rate,
+                r->hits ? (double)r->latency_sum / r->hits : 0.0);
+    }
+    fclose(fp);
+
+    // Upper left edge of the hit rate against false rate scatter
+    snprintf(path, sizeof(path), "%s_roc.csv", prefix);
+    if (!(fp = fopen(path, "w")) || !(order = malloc(point_cnt * sizeof(uint32_t))))
+    {
+        perror(path);
+        return (FAILURE);
+    }
+    for (i = 0;i < point_cnt;i++)
+    {
+        order[i] = i;
+    }
+    sort_results = results;
+    qsort(order, point_cnt, sizeof(uint32_t), RocOrder);
+    fprintf(fp, "false_per_hour,hit_rate,");
+    for (a = 0;a < axis_cnt;a++)
+    {
+        fprintf(fp, "%s%s", axes[a].param->name, (a + 1 < axis_cnt) ? "," : "\n");
+    }
+    for (i = 0;i < point_cnt;i++)
+    {
+        Rates(&results[order[i]], &hit_rate, &false_rate);
+        if (hit_rate > best)
+        {
+            best = hit_rate;
+            fprintf(fp, "%.3f,%.4f,", false_rate, hit_rate);
+            for (a = 0;a < axis_cnt;a++)
+            {
+                fprintf(fp, "%u%s", AxisValue(&axes[a], order[i]),
+                        (a + 1 < axis_cnt) ? "," : "\n");
+            }
+        }
+    }
+    free(order);
+    fclose(fp);
+
+    // Each value of each setting pooled over everything else
+    snprintf(path, sizeof(path), "%s_params.csv", prefix);
+    if (!(fp = fopen(path, "w")))
+    {
+        perror(path);
+        return (FAILURE);
+    }
+    fprintf(fp, "param,value,hit_rate,false_per_hour\n");
+    for (a = 0;a < axis_cnt;a++)
+    {
+        uint32_t v = 0;
+        for (v = 0;v < axes[a].count;v++)
+        {
+            ReplayResult pooled;
+            memset(&pooled, 0, sizeof(pooled));
+            for (i = 0;i < point_cnt;i++)
+            {
+                if (AxisValue(&axes[a], i) == axes[a].lo + v * axes[a].step)
+                {
+                    ReplayAccumulate(&pooled, &results[i]);
+                }
+            }
+            Rates(&pooled, &hit_rate, &false_rate);
+            fprintf(fp, "%s,%u,%.4f,%.3f\n", axes[a].param->name,
+                    axes[a].lo + v * axes[a].step, hit_rate, false_rate);
+        }
+    }
+    fclose(fp);
+    return (SUCCESS);
+}
@@ -0,0 +1,447 @@
+/**
+@file synth.c
+@brief Synthetic TCS3414 traces from a parametric model of the target's world
+@author Joe Brown
+*/
+#include <math.h>
+#include <stddef.h>
+#include "global.h"
+#include "synth.h"
+
+// No shots or flashes until the replay has calibrated and started detecting,
+// see REPLAY_SETTLE_MS and REPLAY_STARTUP_MS
+#define SYNTH_QUIET_MS      6000
+#define SYNTH_NEVER         1e300
+
+/** @brief Random numbers, xorshift64* seeded through splitmix64 */
+typedef struct
+{
+    uint64_t state;
+    double   spare;
+    uint8_t  has_spare;
+} Rng;
+
+/** @brief A setting that can be changed by name */
+typedef struct
+{
+    const char* name;
+    size_t      offset;     /**< of the double in SynthModel */
+} Setting;
+
+/** @brief A named set of settings */
+typedef struct
+{
+    const char* name;
+    const char* settings;
+} Preset;
+
+#define SETTING(f) {#f, offsetof(SynthModel, f)}
+static const Setting settings[] =
+{
+    SETTING(duration_ms),
+    SETTING(period_ms),
+    SETTING(ambient_red),
+    SETTING(ambient_green),
+    SETTING(ambient_blue),
+    SETTING(drift_pct),
+    SETTING(steps_per_min),
+    SETTING(step_pct),
+    SETTING(ramp_ms),
+    SETTING(read_noise),
+    SETTING(noise_pct),
+    SETTING(shots_per_min),
+    SETTING(dwell_min_ms),
+    SETTING(dwell_max_ms),
+    SETTING(laser_power),
+    SETTING(laser_leak_pct),
+    SETTING(spot_mm),
+    SETTING(aim_mm),
+    SETTING(jitter_mm),
+    SETTING(sweep_mm_s),
+    SETTING(flashes_per_min),
+    SETTING(flash_power),
+    SETTING(flash_ms)
+};
+#undef SETTING
+#define NUM_SETTINGS (sizeof(settings) / sizeof(settings[0]))
+
+static const Preset presets[] =
+{
+    // Lights switched on and off every few seconds, instantly
+    {"switching", "steps_per_min=12 step_pct=80 ramp_ms=0"},
+    // A small spot aimed loosely, often only partly on the sensor
+    {"partial",   "spot_mm=2 aim_mm=2.5 jitter_mm=0.8"},
+    // A bot driving past with the trigger held, the spot crosses the sensor
+    // somewhere in the middle of a long dwell
+    {"sweep",     "sweep_mm_s=12 dwell_min_ms=1500 dwell_max_ms=3000 aim_mm=3"},
+    // A target riding a train past a held laser, the spot crosses the sensor
+    // in a few hundred ms, see DETECT_FAST
+    {"train",     "sweep_mm_s=40 dwell_min_ms=300 dwell_max_ms=600 aim_mm=1 jitter_mm=0.5"},
+    // Camera flashes
+    {"flashes",   "flashes_per_min=12"},
+    // Bright, drifting window light and the noise that comes with it
+    {"daylight",  "ambient_red=1000 ambient_green=1150 ambient_blue=1000 "
+                  "drift_pct=20 noise_pct=2"}
+};
+#define NUM_PRESETS (sizeof(presets) / sizeof(presets[0]))
+
+/**
+@brief Seed a generator, any seed gives a well mixed state
+*/
+static void RngSeed(Rng* rng, uint64_t seed);
+
+/**
+@brief Next 64 random bits
+*/
+static uint64_t RngNext(Rng* rng);
+
+/**
+@brief Uniform in [0, 1)
+*/
+static double Uniform(Rng* rng);
+
+/**
+@brief Standard normal
+*/
+static double Gauss(Rng* rng);
+
+/**
+@brief Time to the next event of a process happening per_min times a minute
+*/
+static double Interval(Rng* rng, double per_min);
+
+/**
+@brief Clamp a level into a 16 bit sensor count
+*/
+static uint16_t Count(double value);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void SynthDefaults(SynthModel* model)
+{
+    model->duration_ms     = 600000;
+    model->period_ms       = DETECT_READ_MS;
+    model->ambient_red     = 250;
+    model->ambient_green   = 290;
+    model->ambient_blue    = 200;
+    model->drift_pct       = 5;
+    model->steps_per_min   = 0;
+    model->step_pct        = 50;
+    model->ramp_ms         = 500;
+    model->read_noise      = 2;
+    model->noise_pct       = 1;
+    model->shots_per_min   = 6;
+    model->dwell_min_ms    = 500;
+    model->dwell_max_ms    = 1000;
+    model->laser_power     = 900;
+    model->laser_leak_pct  = 2;
+    model->spot_mm         = 5;
+    model->aim_mm          = 1.5;
+    model->jitter_mm       = 0.3;
+    model->sweep_mm_s      = 0;
+    model->flashes_per_min = 0;
+    model->flash_power     = 3000;
+    model->flash_ms        = 50;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t SynthSet(SynthModel* model, const char* arg)
+{
+    const char* eq = strchr(arg, '=');
+    char* end = NULL;
+    double value = 0;
+    uint8_t i = 0;
+
+    if (!eq)
+    {
+        for (i = 0;i < NUM_PRESETS;i++)
+        {
+            if (strcmp(arg, presets[i].name) == 0)
+            {
+                // Presets are settings separated by spaces
+                char buf[256];
+                char* save = NULL;
+                char* s = NULL;
+                strncpy(buf, presets[i].settings, sizeof(buf) - 1);
+                buf[sizeof(buf) - 1] = '\0';
+                for (s = strtok_r(buf, " ", &save);s;s = strtok_r(NULL, " ", &save))
+                {
+                    if (SynthSet(model, s) != SUCCESS)
+                    {
+                        return (FAILURE);
+                    }
+                }
+                return (SUCCESS);
+            }
+        }
+        fprintf(stderr, "%s: unknown preset\n", arg);
+        return (FAILURE);
+    }
+    for (i = 0;i < NUM_SETTINGS;i++)
+    {
+        if (strlen(settings[i].name) == (size_t)(eq - arg) &&
+            strncmp(settings[i].name, arg, eq - arg) == 0)
+        {
+            break;
+        }
+    }
+    value = strtod(eq + 1, &end);
+    if (i == NUM_SETTINGS || end == eq + 1 || *end != '\0' || value < 0)
+    {
+        fprintf(stderr, "%s: expected setting=value, see -l\n", arg);
+        return (FAILURE);
+    }
+    *(double*)((uint8_t*)model + settings[i].offset) = value;
+    if (model->period_ms < 1)
+    {
+        model->period_ms = 1;
+    }
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void SynthPrint(FILE* fp, const SynthModel* model)
+{
+    uint8_t i = 0;
+    for (i = 0;i < NUM_SETTINGS;i++)
+    {
+        fprintf(fp, "  %-16s %g\n", settings[i].name,
+                *(const double*)((const uint8_t*)model + settings[i].offset));
+    }
+    fprintf(fp, "presets:\n");
+    for (i = 0;i < NUM_PRESETS;i++)
+    {
+        fprintf(fp, "  %-16s %s\n", presets[i].name, presets[i].settings);
+    }
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t SynthTrace(const SynthModel* model, uint64_t seed, Trace* trace)
+{
+    const double spot2 = model->spot_mm * model->spot_mm;
+    const double leak = model->laser_leak_pct / 100;
+    const double walk = model->drift_pct / 100 * sqrt(model->period_ms / 60000);
+    uint32_t count = model->duration_ms / model->period_ms + 1;
+    double drift = 1;
+    double step_from = 1;
+    double step_to = 1;
+    double step_at = 0;
+    double next_step = 0;
+    double next_shot = 0;
+    double next_flash = 0;
+    double flash_end = 0;
+    // Shot in progress, the spot moves from (x0, y) at vx mm per ms
+    uint8_t  shooting = FALSE;
+    uint8_t  scoring = FALSE;
+    double   shot_start = 0;
+    double   shot_end = 0;
+    double   x0 = 0;
+    double   y = 0;
+    double   vx = 0;
+    uint32_t i = 0;
+    char name[32];
+    Rng rng;
+
+    memset(trace, 0, sizeof(*trace));
+    snprintf(name, sizeof(name), "synth-%llu", (unsigned long long)seed);
+    trace->name = strdup(name);
+    trace->samples = malloc(count * sizeof(TraceSample));
+    if (!trace->name || !trace->samples)
+    {
+        SynthFree(trace);
+        return (FAILURE);
+    }
+
+    RngSeed(&rng, seed);
+    next_step  = Interval(&rng, model->steps_per_min);
+    next_shot  = SYNTH_QUIET_MS + Interval(&rng, model->shots_per_min);
+    next_flash = SYNTH_QUIET_MS + Interval(&rng, model->flashes_per_min);
+    for (i = 0;i < count;i++)
+    {
+        TraceSample* s = &trace->samples[i];
+        double ms = i * model->period_ms;
+        double level = 0;
+        double laser = 0;
+        double flash = 0;
+        double r = 0, g = 0, b = 0;
+        uint8_t truth = FALSE;
+
+        // Ambient, a random walk and lights switched with a ramp
+        drift *= 1 + Gauss(&rng) * walk;
+        drift = (drift < 0.05) ? 0.05 : (drift > 20) ? 20 : drift;
+        if (ms >= next_step)
+        {
+            double f = 1 + (2 * Uniform(&rng) - 1) * model->step_pct / 100;
+            step_from = (ms - step_at < model->ramp_ms) ?
+                        step_from + (step_to - step_from) * (ms - step_at) / model->ramp_ms :
+                        step_to;
+            step_to = step_from * ((f < 0.05) ? 0.05 : f);
+            step_to = (step_to < 0.05) ? 0.05 : (step_to > 20) ? 20 : step_to;
+            step_at = ms;
+            next_step = ms + Interval(&rng, model->steps_per_min);
+        }
+        level = drift * ((ms - step_at < model->ramp_ms) ?
+                         step_from + (step_to - step_from) * (ms - step_at) / model->ramp_ms :
+                         step_to);
+
+        // Laser
+        if (!shooting && ms >= next_shot)
+        {
+            double dwell = model->dwell_min_ms +
+                           Uniform(&rng) * (model->dwell_max_ms - model->dwell_min_ms);
+            double on_target = 0;
+            shooting = TRUE;
+            shot_start = next_shot;
+            shot_end = shot_start + dwell;
+            y = Gauss(&rng) * model->aim_mm;
+            if (model->sweep_mm_s > 0)
+            {
+                // Cross the sensor half way through the dwell
+                vx = model->sweep_mm_s / 1000;
+                x0 = -vx * dwell / 2;
+                on_target = (y * y < spot2) ? 2 * sqrt(spot2 - y * y) / vx : 0;
+                on_target = (on_target > dwell) ? dwell : on_target;
+            }
+            else
+            {
+                vx = 0;
+                x0 = Gauss(&rng) * model->aim_mm;
+                on_target = (x0 * x0 + y * y <= spot2) ? dwell : 0;
+            }
+            scoring = (on_target >= DETECT_HIT_MIN_MS && on_target < DETECT_HIT_MAX_MS);
+        }
+        if (shooting && ms >= shot_end)
+        {
+            shooting = FALSE;
+            next_shot = shot_end + Interval(&rng, model->shots_per_min);
+        }
+        if (shooting && ms >= shot_start)
+        {
+            double x = x0 + vx * (ms - shot_start);
+            double jx = x + Gauss(&rng) * model->jitter_mm;
+            double jy = y + Gauss(&rng) * model->jitter_mm;
+            laser = model->laser_power * exp(-2 * (jx * jx + jy * jy) / spot2);
+            truth = scoring && (x * x + y * y <= spot2);
+        }
+
+        // Flashes
+        if (ms >= next_flash)
+        {
+            flash_end = next_flash + model->flash_ms;
+            next_flash += model->flash_ms + Interval(&rng, model->flashes_per_min);
+        }
+        if (ms < flash_end)
+        {
+            flash = model->flash_power;
+        }
+
+        r = model->ambient_red * level + laser + flash;
+        g = model->ambient_green * level + laser * leak + flash;
+        b = model->ambient_blue * level + laser * leak + flash * 1.1;
+        r += Gauss(&rng) * (model->read_noise + r * model->noise_pct / 100);
+        g += Gauss(&rng) * (model->read_noise + g * model->noise_pct / 100);
+        b += Gauss(&rng) * (model->read_noise + b * model->noise_pct / 100);
+
+        s->ms    = (uint32_t)ms;
+        s->red   = Count(r);
+        s->green = Count(g);
+        s->blue  = Count(b);
+        s->clear = Count((double)s->red + s->green + s->blue);
+        s->truth = truth;
+        s->state = TRACE_STATE_UNKNOWN;
+        s->event = TRACE_EVENT_NONE;
+    }
+    trace->count = count;
+    trace->first_ms = trace->samples[0].ms;
+    trace->last_ms = trace->samples[count - 1].ms;
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void SynthFree(Trace* trace)
+{
+    free(trace->name);
+    free(trace->samples);
+    memset(trace, 0, sizeof(*trace));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t SynthWrite(const Trace* trace, const char* path)
+{
+    uint32_t i = 0;
+    FILE* fp = fopen(path, "w");
+    if (!fp)
+    {
+        return (FAILURE);
+    }
+    fprintf(fp, "# %s\n", trace->name);
+    for (i = 0;i < trace->count;i++)
+    {
+        const TraceSample* s = &trace->samples[i];
+        fprintf(fp, "%u %u %u %u %u %u\n", s->ms, s->red, s->green, s->blue,
+                s->clear, s->truth);
+    }
+    return ((ferror(fp) | fclose(fp)) ? FAILURE : SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                 Random
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void RngSeed(Rng* rng, uint64_t seed)
+{
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    rng->state = z ? z : 1;
+    rng->has_spare = FALSE;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint64_t RngNext(Rng* rng)
+{
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    return rng->state * 0x2545F4914F6CDD1DULL;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+double Uniform(Rng* rng)
+{
+    return (RngNext(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+double Gauss(Rng* rng)
+{
+    double u = 0;
+    double v = 0;
+    double m = 0;
+    if (rng->has_spare)
+    {
+        rng->has_spare = FALSE;
+        return (rng->spare);
+    }
+    u = 1 - Uniform(rng);
+    v = Uniform(rng);
+    m = sqrt(-2 * log(u));
+    rng->spare = m * sin(2 * M_PI * v);
+    rng->has_spare = TRUE;
+    return (m * cos(2 * M_PI * v));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+double Interval(Rng* rng, double per_min)
+{
+    if (per_min <= 0)
+    {
+        return (SYNTH_NEVER);
+    }
+    return (-log(1 - Uniform(rng)) * 60000 / per_min);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+uint16_t Count(double value)
+{
+    return (value <= 0) ? 0 : (value >= 0xFFFF) ? 0xFFFF : (uint16_t)(value + 0.5);
+}
@@ -0,0 +1,110 @@
+/**
+@file synth.h
+@brief Synthetic TCS3414 traces from a parametric model of the target's world
+@author Joe Brown
+@details
+Builds labeled traces from a handful of physical settings so the detector can
+be pushed through cases that are rare or missing in recordings: lights being
+switched, partial beam coverage, a spot swept across the sensor by a moving
+bot, flashes.
+
+Ambient light is a red, green and blue level that random walks (drift) and
+now and then jumps to a new level (a light switched) over ramp_ms. Shots
+arrive at random with a dwell between dwell_min_ms and dwell_max_ms. The
+laser spot is a gaussian of radius spot_mm aimed aim_mm (standard deviation)
+off the sensor, shaking by jitter_mm every sample, and with sweep_mm_s set it
+travels across the target at that speed for the whole dwell. The sensor sees
+laser_power red counts with the spot centred and less as it moves off, plus a
+little green and blue. Flashes are white light for flash_ms. Every channel
+gets read noise plus noise_pct of its level, and clear is the sum of the
+three colors.
+
+Labels follow the rules of the game rather than what the sensor could see.
+A shot scores when the spot centre stays within spot_mm of the sensor for a
+time inside the DETECT_HIT_MIN_MS to DETECT_HIT_MAX_MS window, and truth is
+set on the samples where it is. A held shot is on the sensor for its whole
+dwell or not at all, a swept one for as long as it takes to cross.
+
+The same model and seed always give the same trace.
+*/
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stdio.h>
+#include "trace.h"
+
+/** @brief Settings of the world being synthesized */
+typedef struct
+{
+    double duration_ms;
+    double period_ms;           /**< between samples, the sensor read period */
+    // Ambient
+    double ambient_red;         /**< counts */
+    double ambient_green;
+    double ambient_blue;
+    double drift_pct;           /**< random walk per minute, percent of level */
+    double steps_per_min;       /**< lights switched */
+    double step_pct;            /**< largest change at a switch, percent */
+    double ramp_ms;             /**< how long a switch takes */
+    // Sensor
+    double read_noise;          /**< counts */
+    double noise_pct;           /**< of the level */
+    // Laser
+    double shots_per_min;
+    double dwell_min_ms;
+    double dwell_max_ms;
+    double laser_power;         /**< red counts with the spot centred */
+    double laser_leak_pct;      /**< of the red that shows up in green and blue */
+    double spot_mm;             /**< gaussian radius of the spot */
+    double aim_mm;              /**< aim error, standard deviation */
+    double jitter_mm;           /**< shake each sample */
+    double sweep_mm_s;          /**< spot speed across the target, 0 to hold */
+    // Flashes
+    double flashes_per_min;
+    double flash_power;         /**< counts in each channel */
+    double flash_ms;
+} SynthModel;
+
+/**
+@brief Set a model to a steady indoor scene with clean held shots
+*/
+extern void SynthDefaults(SynthModel* model);
+
+/**
+@brief Change a model from a name=value setting or the name of a preset
+@details
+The defaults are a steady indoor scene. Presets are switching, partial,
+sweep, train, flashes and daylight, each changes only the settings it is about so
+they stack.
+@param[in,out] model model to change
+@param[in] arg setting or preset
+@return SUCCESS, or FAILURE with the reason on stderr
+*/
+extern int8_t SynthSet(SynthModel* model, const char* arg);
+
+/**
+@brief Print every setting of a model and the presets
+*/
+extern void SynthPrint(FILE* fp, const SynthModel* model);
+
+/**
+@brief Synthesize one trace
+@param[in] model world to synthesize
+@param[in] seed any value, the same seed gives the same trace
+@param[out] trace samples in memory, free with SynthFree
+@return SUCCESS, or FAILURE when out of memory
+*/
+extern int8_t SynthTrace(const SynthModel* model, uint64_t seed, Trace* trace);
+
+/**
+@brief Release a trace made by SynthTrace
+*/
+extern void SynthFree(Trace* trace);
+
+/**
+@brief Write a trace in the text format
+@return SUCCESS or FAILURE
+*/
+extern int8_t SynthWrite(const Trace* trace, const char* path);
+
+#endif // SYNTH_H
@@ -0,0 +1,417 @@
+/**
+@file trace.c
+@brief Recorded sensor traces for host replay
+@author Joe Brown
+*/
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "global.h"
+#include "trace.h"
+
+#define TRACE_FIELDS    8
+
+/**
+@brief Split a line into unsigned fields
+@param[in] line text to parse, changed in place
+@param[out] fields parsed values
+@return number of fields found, -1 if one was not a number
+*/
+static int ParseFields(char* line, unsigned long* fields);
+
+/**
+@brief Make room for one more trace in a corpus
+@return the new trace, cleared, or NULL when out of memory
+*/
+static Trace* TraceSetGrow(TraceSet* set);
+
+/**
+@brief Read a text trace into a new trace in the corpus
+*/
+static int8_t LoadText(TraceSet* set, const char* path);
+
+/**
+@brief Map a packed trace and add the blocks that pass the filters
+*/
+static int8_t LoadPacked(TraceSet* set, const char* path, int fd, uint64_t size);
+
+/**
+@brief Read one LEB128 varint
+@param[in,out] pos read position, moved past the varint
+@param[in] end end of the column
+@param[out] value decoded value
+@return SUCCESS, or FAILURE if the column ran out
+*/
+static int8_t ReadVarint(const uint8_t** pos, const uint8_t* end, uint32_t* value);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                 Cursor
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void TraceBegin(const Trace* trace, TraceCursor* cursor)
+{
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->trace = trace;
+    memcpy(cursor->pos, trace->column, sizeof(cursor->pos));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+const TraceSample* TraceNext(TraceCursor* cursor)
+{
+    const Trace* trace = cursor->trace;
+    TraceSample* s = &cursor->sample;
+    uint32_t v[TRACE_COL_MARK];
+    uint8_t c = 0;
+
+    if (cursor->index >= trace->count)
+    {
+        return (NULL);
+    }
+    if (trace->samples)
+    {
+        return (&trace->samples[cursor->index++]);
+    }
+    for (c = 0;c < TRACE_COL_MARK;c++)
+    {
+        if (ReadVarint(&cursor->pos[c], trace->column_end[c], &v[c]) != SUCCESS)
+        {
+            return (NULL);
+        }
+    }
+    if (cursor->mark_run == 0)
+    {
+        if (ReadVarint(&cursor->pos[TRACE_COL_MARK], trace->column_end[TRACE_COL_MARK],
+                       &cursor->mark_run) != SUCCESS ||
+            cursor->mark_run == 0 ||
+            cursor->pos[TRACE_COL_MARK] >= trace->column_end[TRACE_COL_MARK])
+        {
+            return (NULL);
+        }
+        cursor->mark = *cursor->pos[TRACE_COL_MARK]++;
+    }
+    cursor->mark_run--;
+
+    // Channels are zigzag coded so -1 is 1, 1 is 2 and so on
+#define UNZIGZAG(x)     (((x) >> 1) ^ -((x) & 1))
+    s->ms    += v[TRACE_COL_MS];
+    s->red   += UNZIGZAG(v[TRACE_COL_RED]);
+    s->green += UNZIGZAG(v[TRACE_COL_GREEN]);
+    s->blue  += UNZIGZAG(v[TRACE_COL_BLUE]);
+    s->clear += UNZIGZAG(v[TRACE_COL_CLEAR]);
+#undef UNZIGZAG
+    s->truth = cursor->mark & 1;
+    s->state = (cursor->mark >> 1) & 7;
+    s->event = cursor->mark >> 4;
+    cursor->index++;
+    return (s);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t ReadVarint(const uint8_t** pos, const uint8_t* end, uint32_t* value)
+{
+    const uint8_t* p = *pos;
+    uint32_t v = 0;
+    uint8_t shift = 0;
+    do
+    {
+        if (p >= end || shift > 28)
+        {
+            return (FAILURE);
+        }
+        v |= (uint32_t)(*p & 0x7F) << shift;
+        shift += 7;
+    } while (*p++ & 0x80);
+    *pos = p;
+    *value = v;
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                 Corpus
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void TraceSetInit(TraceSet* set)
+{
+    memset(set, 0, sizeof(*set));
+    set->target = -1;
+    set->session = -1;
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t TraceSetAdd(TraceSet* set, const char* path)
+{
+    struct stat st;
+    uint32_t magic = 0;
+    int8_t ret = FAILURE;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        perror(path);
+        return (FAILURE);
+    }
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(TracePackHeader) &&
+        pread(fd, &magic, sizeof(magic), 0) == sizeof(magic) &&
+        magic == TRACE_PACK_MAGIC)
+    {
+        ret = LoadPacked(set, path, fd, st.st_size);
+    }
+    else
+    {
+        ret = LoadText(set, path);
+    }
+    close(fd);
+    return (ret);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void TraceSetFree(TraceSet* set)
+{
+    uint32_t i = 0;
+    for (i = 0;i < set->count;i++)
+    {
+        free(set->traces[i].name);
+        free(set->traces[i].samples);
+    }
+    for (i = 0;i < set->map_cnt;i++)
+    {
+        munmap(set->maps[i], set->map_sizes[i]);
+    }
+    free(set->traces);
+    free(set->maps);
+    free(set->map_sizes);
+    TraceSetInit(set);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+Trace* TraceSetGrow(TraceSet* set)
+{
+    Trace* grown = realloc(set->traces, (set->count + 1) * sizeof(Trace));
+    if (!grown)
+    {
+        return (NULL);
+    }
+    set->traces = grown;
+    memset(&set->traces[set->count], 0, sizeof(Trace));
+    return (&set->traces[set->count++]);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t LoadText(TraceSet* set, const char* path)
+{
+    char line[256];
+    unsigned long f[TRACE_FIELDS];
+    uint32_t capacity = 0;
+    uint32_t line_no = 0;
+    Trace* trace = NULL;
+    int n = 0;
+    FILE* fp = fopen(path, "r");
+    if (!fp)
+    {
+        perror(path);
+        return (FAILURE);
+    }
+    if (!(trace = TraceSetGrow(set)) || !(trace->name = strdup(path)))
+    {
+        fprintf(stderr, "%s: out of memory\n", path);
+        goto load_failed;
+    }
+    while (fgets(line, sizeof(line), fp))
+    {
+        TraceSample* s = NULL;
+        line_no++;
+        n = ParseFields(line, f);
+        if (n == 0)
+        {
+            continue;
+        }
+        if (n < 5)
+        {
+            fprintf(stderr, "%s:%u: expected ms red green blue clear [truth [state [event]]]\n",
+                    path, line_no);
+            goto load_failed;
+        }
+        if (f[1] > 0xFFFF || f[2] > 0xFFFF || f[3] > 0xFFFF || f[4] > 0xFFFF ||
+            (n > 6 && f[6] > 7) || (n > 7 && f[7] > 15) ||
+            (trace->count && f[0] < trace->last_ms))
+        {
+            fprintf(stderr, "%s:%u: field out of range or time went backwards\n",
+                    path, line_no);
+            goto load_failed;
+        }
+        if (trace->count == capacity)
+        {
+            TraceSample* grown;
+            capacity = capacity ? capacity * 2 : 4096;
+            grown = realloc(trace->samples, capacity * sizeof(TraceSample));
+            if (!grown)
+            {
+                fprintf(stderr, "%s: out of memory\n", path);
+                goto load_failed;
+            }
+            trace->samples = grown;
+        }
+        s = &trace->samples[trace->count++];
+        s->ms    = (uint32_t)f[0];
+        s->red   = (uint16_t)f[1];
+        s->green = (uint16_t)f[2];
+        s->blue  = (uint16_t)f[3];
+        s->clear = (uint16_t)f[4];
+        s->truth = (n > 5) && f[5];
+        s->state = (n > 6) ? (uint8_t)f[6] : TRACE_STATE_UNKNOWN;
+        s->event = (n > 7) ? (uint8_t)f[7] : TRACE_EVENT_NONE;
+        if (trace->count == 1)
+        {
+            trace->first_ms = s->ms;
+        }
+        trace->last_ms = s->ms;
+    }
+    fclose(fp);
+    return (SUCCESS);
+load_failed:
+    fclose(fp);
+    if (trace)
+    {
+        free(trace->name);
+        free(trace->samples);
+        set->count--;
+    }
+    return (FAILURE);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t LoadPacked(TraceSet* set, const char* path, int fd, uint64_t size)
+{
+    const TracePackHeader* header = NULL;
+    const TracePackIndex* index = NULL;
+    const uint8_t* base = NULL;
+    void** maps = NULL;
+    uint64_t* map_sizes = NULL;
+    uint32_t first = set->count;
+    uint16_t b = 0;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        perror(path);
+        return (FAILURE);
+    }
+    maps = realloc(set->maps, (set->map_cnt + 1) * sizeof(void*));
+    if (maps)
+    {
+        set->maps = maps;
+    }
+    map_sizes = realloc(set->map_sizes, (set->map_cnt + 1) * sizeof(uint64_t));
+    if (map_sizes)
+    {
+        set->map_sizes = map_sizes;
+    }
+    if (!maps || !map_sizes)
+    {
+        fprintf(stderr, "%s: out of memory\n", path);
+        munmap(map, size);
+        return (FAILURE);
+    }
+    set->maps[set->map_cnt] = map;
+    set->map_sizes[set->map_cnt] = size;
+    set->map_cnt++;
+
+    base = map;
+    header = map;
+    if (header->version != TRACE_PACK_VERSION ||
+        header->index_offset > size ||
+        (size - header->index_offset) / sizeof(TracePackIndex) < header->block_cnt)
+    {
+        fprintf(stderr, "%s: bad header or unsupported version\n", path);
+        goto fail;
+    }
+    index = (const TracePackIndex*)(base + header->index_offset);
+    // We are only going to walk the samples sequentially
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    for (b = 0;b < header->block_cnt;b++)
+    {
+        const TracePackIndex* entry = &index[b];
+        const TracePackBlock* block = NULL;
+        const uint8_t* column = NULL;
+        uint64_t left = 0;
+        Trace* trace = NULL;
+        uint8_t c = 0;
+        if ((set->target >= 0 && entry->target != set->target) ||
+            (set->session >= 0 && entry->session != set->session))
+        {
+            continue;
+        }
+        if (entry->offset > size || size - entry->offset < sizeof(TracePackBlock))
+        {
+            goto bad_block;
+        }
+        block = (const TracePackBlock*)(base + entry->offset);
+        if (block->magic != TRACE_BLOCK_MAGIC || block->count != entry->count)
+        {
+            goto bad_block;
+        }
+        if (!(trace = TraceSetGrow(set)) ||
+            !(trace->name = malloc(strlen(path) + 16)))
+        {
+            fprintf(stderr, "%s: out of memory\n", path);
+            goto fail;
+        }
+        sprintf(trace->name, "%s[%u.%u]", path, entry->target, entry->session);
+        trace->target   = entry->target;
+        trace->session  = entry->session;
+        trace->count    = entry->count;
+        trace->first_ms = entry->first_ms;
+        trace->last_ms  = entry->last_ms;
+        column = (const uint8_t*)(block + 1);
+        left = size - entry->offset - sizeof(TracePackBlock);
+        for (c = 0;c < TRACE_COLUMNS;c++)
+        {
+            if (block->column_size[c] > left)
+            {
+                goto bad_block;
+            }
+            trace->column[c] = column;
+            trace->column_end[c] = column + block->column_size[c];
+            column += block->column_size[c];
+            left -= block->column_size[c];
+        }
+    }
+    return (SUCCESS);
+bad_block:
+    fprintf(stderr, "%s: block %u is damaged\n", path, b);
+fail:
+    // Drop every trace taken from this file and the mapping they point into,
+    // so the set holds only whole files
+    while (set->count > first)
+    {
+        free(set->traces[--set->count].name);
+    }
+    munmap(map, size);
+    set->map_cnt--;
+    return (FAILURE);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int ParseFields(char* line, unsigned long* fields)
+{
+    int n = 0;
+    char* end = NULL;
+    while (*line)
+    {
+        if (isspace((unsigned char)*line) || *line == ',')
+        {
+            line++;
+            continue;
+        }
+        if (*line == '#' || n == TRACE_FIELDS)
+        {
+            break;
+        }
+        fields[n++] = strtoul(line, &end, 10);
+        if (end == line)
+        {
+            return (-1);
+        }
+        line = end;
+    }
+    return (n);
+}
@@ -0,0 +1,204 @@
+/**
+@file trace.h
+@brief Recorded sensor traces for host replay
+@author Joe Brown
+@details
+Traces come as text or packed binary files.
+
+A text trace is one recording, one sample per line, fields separated by
+spaces, tabs or commas:
+
+    <ms> <red> <green> <blue> <clear> [truth [state [event]]]
+
+ms is the time the sample was taken and must not go backwards. The four color
+channels are raw TCS3414 counts. truth is 1 on samples where a scoring shot
+had the laser on the target and 0 (or left out) everywhere else. state and
+event are what the target itself was doing, see TraceState and TraceEvent.
+Blank lines and lines starting with # are ignored.
+
+A packed trace (written by tracepack) holds any number of recordings, one
+block per target per session. All fields are little endian.
+
+    TracePackHeader
+    block 0: TracePackBlock, then its columns back to back
+    block 1: ...
+    TracePackIndex[block_cnt] at index_offset
+
+Each block stores its samples a column at a time. ms and the four channels are
+delta coded against the previous sample (starting from 0) as LEB128 varints,
+the channels zigzag coded first so small steps either way take one byte. The
+mark column is run length coded as (varint run, mark byte) pairs, where the
+mark byte is truth | state << 1 | event << 4.
+
+Packed files are mapped rather than read and samples are decoded straight out
+of the mapping as a TraceCursor walks them, so nothing is copied or held in
+memory per sample.
+*/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/** @brief What the target was doing when a sample was taken */
+enum TraceState
+{
+    TRACE_STATE_UNKNOWN = 0,
+    TRACE_STATE_DETECTING,
+    TRACE_STATE_CONFIG,
+    TRACE_STATE_STUNNED,
+    TRACE_STATE_DEAD
+};
+
+/** @brief Events the target published on a sample */
+enum TraceEvent
+{
+    TRACE_EVENT_NONE = 0,
+    TRACE_EVENT_STUN,
+    TRACE_EVENT_STUN_TIMEOUT,
+    TRACE_EVENT_CONFIG,
+    TRACE_EVENT_CNT_TICK,
+    TRACE_EVENT_KILL
+};
+
+/** @brief One sensor sample and its labels */
+typedef struct
+{
+    uint32_t ms;
+    uint16_t red;
+    uint16_t green;
+    uint16_t blue;
+    uint16_t clear;
+    uint8_t  truth;
+    uint8_t  state;     /**< enum TraceState, below 8 */
+    uint8_t  event;     /**< enum TraceEvent, below 16 */
+} TraceSample;
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                              Packed format
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+#define TRACE_PACK_MAGIC    0x43525454  // "TTRC"
+#define TRACE_BLOCK_MAGIC   0x4B4C4254  // "TBLK"
+#define TRACE_PACK_VERSION  1
+
+enum TraceColumn
+{
+    TRACE_COL_MS,
+    TRACE_COL_RED,
+    TRACE_COL_GREEN,
+    TRACE_COL_BLUE,
+    TRACE_COL_CLEAR,
+    TRACE_COL_MARK,
+    TRACE_COLUMNS
+};
+
+/** @brief Start of a packed file */
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t block_cnt;
+    uint64_t index_offset;
+} TracePackHeader;
+
+/** @brief Start of one recording in a packed file */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t count;
+    uint32_t column_size[TRACE_COLUMNS];
+} TracePackBlock;
+
+/** @brief Where to find one recording, so a target or session can be picked
+out without touching the others */
+typedef struct
+{
+    uint16_t target;
+    uint16_t session;
+    uint32_t count;
+    uint32_t first_ms;
+    uint32_t last_ms;
+    uint64_t offset;    /**< of the TracePackBlock */
+} TracePackIndex;
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                 Traces
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+/** @brief One recording, either held in memory or packed in a mapped file */
+typedef struct
+{
+    char*          name;
+    uint16_t       target;
+    uint16_t       session;
+    uint32_t       count;
+    uint32_t       first_ms;
+    uint32_t       last_ms;
+    TraceSample*   samples;                 /**< text traces, NULL if packed */
+    const uint8_t* column[TRACE_COLUMNS];   /**< packed traces, in the mapping */
+    const uint8_t* column_end[TRACE_COLUMNS];
+} Trace;
+
+/** @brief Position in a trace */
+typedef struct
+{
+    const Trace*   trace;
+    uint32_t       index;       /**< of the sample Next returns next */
+    TraceSample    sample;      /**< last decoded packed sample */
+    const uint8_t* pos[TRACE_COLUMNS];
+    uint32_t       mark_run;    /**< samples left in the current mark run */
+    uint8_t        mark;
+} TraceCursor;
+
+/** @brief A corpus of traces from any mix of files */
+typedef struct
+{
+    Trace*   traces;
+    uint32_t count;
+    int32_t  target;            /**< only take this target, -1 for all */
+    int32_t  session;           /**< only take this session, -1 for all */
+    void**   maps;              /**< packed files mapped for the traces */
+    uint64_t* map_sizes;
+    uint32_t map_cnt;
+} TraceSet;
+
+/**
+@brief Start walking a trace from its first sample
+@param[in] trace trace to walk, must outlive the cursor
+@param[out] cursor cursor to set up
+*/
+extern void TraceBegin(const Trace* trace, TraceCursor* cursor);
+
+/**
+@brief Step to the next sample
+@details
+For text traces this points into the trace itself. For packed traces the
+sample is decoded into the cursor and the pointer is good until the next call.
+@param[in] cursor cursor set up by TraceBegin
+@return the sample, NULL at the end of the trace or if the data is corrupt
+*/
+extern const TraceSample* TraceNext(TraceCursor* cursor);
+
+/**
+@brief Set up an empty corpus that takes every target and session
+@param[out] set corpus to clear
+*/
+extern void TraceSetInit(TraceSet* set);
+
+/**
+@brief Add the recordings in a text or packed trace file to a corpus
+@details
+A text file adds one trace. A packed file adds one trace per block that
+matches the target and session filters in the set. Errors are reported on
+stderr with the file name.
+@param[in] set corpus to add to
+@param[in] path file to read
+@return SUCCESS or FAILURE
+*/
+extern int8_t TraceSetAdd(TraceSet* set, const char* path);
+
+/**
+@brief Release every trace in a corpus and the files behind them
+@param[in] set corpus filled by TraceSetAdd
+*/
+extern void TraceSetFree(TraceSet* set);
+
+#endif // TRACE_H
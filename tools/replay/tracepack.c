@@ -0,0 +1,309 @@
+/**
+@file tracepack.c
+@brief Convert traces to the packed format and list packed files
+@author Joe Brown
+@details
+    tracepack -o out [-t target] [-s session] trace ...
+    tracepack -l packed ...
+
+Every recording in the input traces, text or packed, becomes one block of the
+output. -t and -s set the target and session of the inputs after them. A text
+input before any -t takes its position on the command line as the target, a
+packed input keeps what it had. -l prints the index of packed files.
+*/
+#include <unistd.h>
+#include "global.h"
+#include "trace.h"
+
+/** @brief Growable byte buffer for one column */
+typedef struct
+{
+    uint8_t* data;
+    uint32_t size;
+    uint32_t capacity;
+} Column;
+
+/**
+@brief Append bytes to a column
+@return SUCCESS, or FAILURE when out of memory
+*/
+static int8_t ColumnPut(Column* col, const void* data, uint32_t len);
+
+/**
+@brief Append an LEB128 varint to a column
+*/
+static int8_t ColumnVarint(Column* col, uint32_t value);
+
+/**
+@brief Encode one recording as a block at the end of the output
+@param[in] fp output positioned at the end
+@param[in] trace recording to write
+@param[out] entry index entry for the block
+@return SUCCESS or FAILURE
+*/
+static int8_t WriteBlock(FILE* fp, const Trace* trace, TracePackIndex* entry);
+
+/**
+@brief Print the index of a packed file
+*/
+static int8_t List(const char* path);
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+//                                  Entry
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int main(int argc, char** argv)
+{
+    const char* out = NULL;
+    TracePackHeader header;
+    TracePackIndex* index = NULL;
+    TraceSet set;
+    FILE* fp = NULL;
+    long target = -1;
+    long session = 0;
+    uint32_t inputs = 0;
+    uint32_t i = 0;
+    int a = 0;
+
+    if (argc > 2 && strcmp(argv[1], "-l") == 0)
+    {
+        int ret = 0;
+        for (a = 2;a < argc;a++)
+        {
+            ret |= (List(argv[a]) != SUCCESS);
+        }
+        return (ret);
+    }
+
+    // Options apply to the inputs after them so walk the arguments in order
+    TraceSetInit(&set);
+    for (a = 1;a < argc;a++)
+    {
+        uint32_t before = set.count;
+        if (strcmp(argv[a], "-o") == 0 && a + 1 < argc)
+        {
+            out = argv[++a];
+            continue;
+        }
+        if (strcmp(argv[a], "-t") == 0 && a + 1 < argc)
+        {
+            target = strtol(argv[++a], NULL, 0);
+            continue;
+        }
+        if (strcmp(argv[a], "-s") == 0 && a + 1 < argc)
+        {
+            session = strtol(argv[++a], NULL, 0);
+            continue;
+        }
+        if (argv[a][0] == '-')
+        {
+            break;
+        }
+        if (TraceSetAdd(&set, argv[a]) != SUCCESS)
+        {
+            return (1);
+        }
+        for (i = before;i < set.count;i++)
+        {
+            if (target >= 0)
+            {
+                set.traces[i].target = target;
+                set.traces[i].session = session;
+            }
+            else if (set.traces[i].samples)
+            {
+                set.traces[i].target = inputs;
+                set.traces[i].session = session;
+            }
+        }
+        inputs++;
+    }
+    if (a < argc || !out || set.count == 0 || set.count > 0xFFFF)
+    {
+        fprintf(stderr, "usage: %s -o out [-t target] [-s session] trace ...\n"
+                        "       %s -l packed ...\n", argv[0], argv[0]);
+        return (2);
+    }
+
+    if (!(fp = fopen(out, "wb")) ||
+        !(index = calloc(set.count, sizeof(TracePackIndex))))
+    {
+        perror(out);
+        return (1);
+    }
+    memset(&header, 0, sizeof(header));
+    header.magic = TRACE_PACK_MAGIC;
+    header.version = TRACE_PACK_VERSION;
+    header.block_cnt = set.count;
+    fwrite(&header, sizeof(header), 1, fp);
+    for (i = 0;i < set.count;i++)
+    {
+        if (WriteBlock(fp, &set.traces[i], &index[i]) != SUCCESS)
+        {
+            fprintf(stderr, "%s: could not pack %s\n", out, set.traces[i].name);
+            fclose(fp);
+            unlink(out);
+            return (1);
+        }
+    }
+    header.index_offset = ftell(fp);
+    fwrite(index, sizeof(TracePackIndex), set.count, fp);
+    rewind(fp);
+    fwrite(&header, sizeof(header), 1, fp);
+    if (ferror(fp) | fclose(fp))
+    {
+        perror(out);
+        unlink(out);
+        return (1);
+    }
+    free(index);
+    TraceSetFree(&set);
+    return (0);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t WriteBlock(FILE* fp, const Trace* trace, TracePackIndex* entry)
+{
+    Column col[TRACE_COLUMNS];
+    TracePackBlock block;
+    TraceSample prev;
+    TraceCursor cursor;
+    const TraceSample* t = NULL;
+    uint32_t run = 0;
+    uint8_t mark = 0;
+    uint8_t c = 0;
+    int8_t ret = FAILURE;
+
+    memset(col, 0, sizeof(col));
+    memset(&prev, 0, sizeof(prev));
+    memset(&block, 0, sizeof(block));
+    entry->target   = trace->target;
+    entry->session  = trace->session;
+    entry->first_ms = trace->first_ms;
+    entry->last_ms  = trace->last_ms;
+    entry->offset   = ftell(fp);
+
+    // Zigzag keeps small steps down small steps up, see TraceNext
+#define ZIGZAG(now, was) (((uint32_t)((int32_t)(now) - (was)) << 1) ^ \
+                          (uint32_t)(((int32_t)(now) - (was)) >> 31))
+    TraceBegin(trace, &cursor);
+    while ((t = TraceNext(&cursor)) != NULL)
+    {
+        uint8_t m = (t->truth & 1) | (t->state & 7) << 1 | (t->event & 15) << 4;
+        if (ColumnVarint(&col[TRACE_COL_MS], t->ms - prev.ms) != SUCCESS ||
+            ColumnVarint(&col[TRACE_COL_RED], ZIGZAG(t->red, prev.red)) != SUCCESS ||
+            ColumnVarint(&col[TRACE_COL_GREEN], ZIGZAG(t->green, prev.green)) != SUCCESS ||
+            ColumnVarint(&col[TRACE_COL_BLUE], ZIGZAG(t->blue, prev.blue)) != SUCCESS ||
+            ColumnVarint(&col[TRACE_COL_CLEAR], ZIGZAG(t->clear, prev.clear)) != SUCCESS)
+        {
+            goto write_done;
+        }
+        if (run && m != mark)
+        {
+            if (ColumnVarint(&col[TRACE_COL_MARK], run) != SUCCESS ||
+                ColumnPut(&col[TRACE_COL_MARK], &mark, 1) != SUCCESS)
+            {
+                goto write_done;
+            }
+            run = 0;
+        }
+        mark = m;
+        run++;
+        prev = *t;
+        entry->count++;
+    }
+#undef ZIGZAG
+    if (entry->count != trace->count ||
+        (run && (ColumnVarint(&col[TRACE_COL_MARK], run) != SUCCESS ||
+                 ColumnPut(&col[TRACE_COL_MARK], &mark, 1) != SUCCESS)))
+    {
+        goto write_done;
+    }
+
+    block.magic = TRACE_BLOCK_MAGIC;
+    block.count = entry->count;
+    for (c = 0;c < TRACE_COLUMNS;c++)
+    {
+        block.column_size[c] = col[c].size;
+    }
+    fwrite(&block, sizeof(block), 1, fp);
+    for (c = 0;c < TRACE_COLUMNS;c++)
+    {
+        fwrite(col[c].data, 1, col[c].size, fp);
+    }
+    ret = ferror(fp) ? FAILURE : SUCCESS;
+write_done:
+    for (c = 0;c < TRACE_COLUMNS;c++)
+    {
+        free(col[c].data);
+    }
+    return (ret);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t ColumnPut(Column* col, const void* data, uint32_t len)
+{
+    if (col->size + len > col->capacity)
+    {
+        uint32_t capacity = col->capacity ? col->capacity * 2 : 4096;
+        uint8_t* grown = NULL;
+        while (capacity < col->size + len)
+        {
+            capacity *= 2;
+        }
+        if (!(grown = realloc(col->data, capacity)))
+        {
+            return (FAILURE);
+        }
+        col->data = grown;
+        col->capacity = capacity;
+    }
+    memcpy(col->data + col->size, data, len);
+    col->size += len;
+    return (SUCCESS);
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t ColumnVarint(Column* col, uint32_t value)
+{
+    uint8_t buf[5];
+    uint8_t n = 0;
+    do
+    {
+        buf[n] = value & 0x7F;
+        value >>= 7;
+        if (value)
+        {
+            buf[n] |= 0x80;
+        }
+        n++;
+    } while (value);
+    return (ColumnPut(col, buf, n));
+}
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+int8_t List(const char* path)
+{
+    TraceSet set;
+    uint32_t i = 0;
+    TraceSetInit(&set);
+    if (TraceSetAdd(&set, path) != SUCCESS)
+    {
+        TraceSetFree(&set);
+        return (FAILURE);
+    }
+    printf("%s\n  target session   samples   first_ms    last_ms      bytes\n", path);
+    for (i = 0;i < set.count;i++)
+    {
+        const Trace* t = &set.traces[i];
+        uint32_t bytes = 0;
+        uint8_t c = 0;
+        for (c = 0;c < TRACE_COLUMNS && !t->samples;c++)
+        {
+            bytes += t->column_end[c] - t->column[c];
+        }
+        printf("  %6u %7u %9u %10u %10u %10u\n", t->target, t->session,
+               t->count, t->first_ms, t->last_ms, bytes);
+    }
+    TraceSetFree(&set);
+    return (SUCCESS);
+}
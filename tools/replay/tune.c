@@ -0,0 +1,24 @@
+/**
+@file tune.c
+@brief Detector settings that can be changed at run time in host builds
+@author Joe Brown
+*/
+#include "global.h"
+#include "tune.h"
+
+Tune g_tune;
+
+//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+void TuneDefaults(void)
+{
+    g_tune.hit_min_ms   = DETECT_HIT_MIN_MS;
+    g_tune.hit_max_ms   = DETECT_HIT_MAX_MS;
+    g_tune.red_margin   = DETECT_RED_MARGIN;
+    g_tune.green_margin = DETECT_GREEN_MARGIN;
+    g_tune.clear_margin = DETECT_CLEAR_MARGIN;
+    g_tune.red_gain     = DETECT_RED_NOISE_GAIN;
+    g_tune.green_gain   = DETECT_GREEN_NOISE_GAIN;
+    g_tune.clear_gain   = DETECT_CLEAR_NOISE_GAIN;
+    g_tune.rise_shift   = DETECT_BASELINE_RISE_SHIFT;
+    g_tune.fall_shift   = DETECT_BASELINE_FALL_SHIFT;
+}
@@ -0,0 +1,72 @@
+/**
+@file tune.h
+@brief Detector settings that can be changed at run time in host builds
+@author Joe Brown
+@details
+The detector takes its settings from config.h at compile time. For sweeps
+detect.c is compiled a second time with TUNE_BIND defined and this header
+forced in ahead of everything else. That pulls in config.h first and then
+points each setting below at a field of g_tune, so the same code runs with
+whatever the sweep puts there.
+*/
+#ifndef TUNE_H
+#define TUNE_H
+
+#include <stdint.h>
+
+/** @brief Run time copies of the config.h detector settings */
+typedef struct
+{
+    uint32_t hit_min_ms;    /**< DETECT_HIT_MIN_MS */
+    uint32_t hit_max_ms;    /**< DETECT_HIT_MAX_MS */
+    uint32_t red_margin;    /**< DETECT_RED_MARGIN */
+    uint32_t green_margin;  /**< DETECT_GREEN_MARGIN */
+    uint32_t clear_margin;  /**< DETECT_CLEAR_MARGIN */
+    uint32_t red_gain;      /**< DETECT_RED_NOISE_GAIN */
+    uint32_t green_gain;    /**< DETECT_GREEN_NOISE_GAIN */
+    uint32_t clear_gain;    /**< DETECT_CLEAR_NOISE_GAIN */
+    uint32_t rise_shift;    /**< DETECT_BASELINE_RISE_SHIFT */
+    uint32_t fall_shift;    /**< DETECT_BASELINE_FALL_SHIFT */
+} Tune;
+
+/** @brief Everything a sweep can change, the detector settings plus the
+CheckForHit period the replay samples at */
+typedef struct
+{
+    Tune     tune;
+    uint32_t period_ms;
+} TunePoint;
+
+/** @brief settings the TUNE_BIND build of detect.c runs with */
+extern Tune g_tune;
+
+/**
+@brief Load g_tune with the values in config.h
+*/
+extern void TuneDefaults(void);
+
+#ifdef TUNE_BIND
+#include "config.h"
+#undef  DETECT_HIT_MIN_MS
+#define DETECT_HIT_MIN_MS           g_tune.hit_min_ms
+#undef  DETECT_HIT_MAX_MS
+#define DETECT_HIT_MAX_MS           g_tune.hit_max_ms
+#undef  DETECT_RED_MARGIN
+#define DETECT_RED_MARGIN           g_tune.red_margin
+#undef  DETECT_GREEN_MARGIN
+#define DETECT_GREEN_MARGIN         g_tune.green_margin
+#undef  DETECT_CLEAR_MARGIN
+#define DETECT_CLEAR_MARGIN         g_tune.clear_margin
+#undef  DETECT_RED_NOISE_GAIN
+#define DETECT_RED_NOISE_GAIN       g_tune.red_gain
+#undef  DETECT_GREEN_NOISE_GAIN
+#define DETECT_GREEN_NOISE_GAIN     g_tune.green_gain
+#undef  DETECT_CLEAR_NOISE_GAIN
+#define DETECT_CLEAR_NOISE_GAIN     g_tune.clear_gain
+#undef  DETECT_BASELINE_RISE_SHIFT
+#define DETECT_BASELINE_RISE_SHIFT  g_tune.rise_shift
+#undef  DETECT_BASELINE_FALL_SHIFT
+#define DETECT_BASELINE_FALL_SHIFT  g_tune.fall_shift
+#endif
+
+#endif // TUNE_H